@@ -0,0 +1,331 @@
+#include "pch.h"
+#include "Assets.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_opengl.h>
+
+struct TextureSlot
+{
+	std::string path;
+	Texture texture;
+	int nrReferences;
+	uint32_t generation; // counts reuses of the slot, so an image decoded for an earlier path is dropped
+	TextureState state;
+	bool hasMipmaps;
+};
+
+struct DecodeJob
+{
+	int slot;
+	uint32_t generation;
+	std::string path;
+};
+
+struct DecodedImage
+{
+	int slot;
+	uint32_t generation;
+	int width, height;
+	std::vector<Uint8> pixels; // RGBA with the top row first, empty when the file could not be decoded
+};
+
+// The slots belong to the GL thread, only the two queues are shared with the worker
+std::vector<TextureSlot> g_TextureSlots{};
+std::vector<int> g_FreeTextureSlots{};
+std::unordered_map<std::string, int> g_TexturesByPath{};
+Texture g_FallbackTexture{};
+int g_NrLoadingTextures{};
+
+std::mutex g_AssetMutex{};
+std::condition_variable g_AssetSignal{};
+std::deque<DecodeJob> g_DecodeJobs{};
+std::deque<DecodedImage> g_DecodedImages{};
+bool g_IsAssetWorkerRunning{ false };
+std::thread g_AssetWorker{};
+
+const int g_FallbackSize{ 8 }; // texels, magenta and black squares
+
+void DecodeImage(const std::string& path, DecodedImage& image)
+{
+	SDL_Surface* pLoaded{ IMG_Load(path.c_str()) };
+	if (pLoaded == nullptr)
+	{
+		std::cerr << "Assets: could not load " << path << ": " << IMG_GetError() << '\n';
+		return;
+	}
+	// Whatever the file holds, the upload always gets the same layout
+	SDL_Surface* pConverted{ SDL_ConvertSurfaceFormat(pLoaded, SDL_PIXELFORMAT_RGBA32, 0) };
+	SDL_FreeSurface(pLoaded);
+	if (pConverted == nullptr)
+	{
+		std::cerr << "Assets: could not convert " << path << ": " << SDL_GetError() << '\n';
+		return;
+	}
+	image.width = pConverted->w;
+	image.height = pConverted->h;
+	size_t rowSize{ size_t(image.width) * 4 };
+	image.pixels.resize(rowSize * image.height);
+	for (int i = 0; i < image.height; i++)
+	{
+		const Uint8* pRow{ static_cast<const Uint8*>(pConverted->pixels) + i * pConverted->pitch };
+		std::copy(pRow, pRow + rowSize, image.pixels.begin() + i * rowSize);
+	}
+	SDL_FreeSurface(pConverted);
+}
+
+void RunAssetWorker()
+{
+	std::unique_lock<std::mutex> lock{ g_AssetMutex };
+	while (true)
+	{
+		g_AssetSignal.wait(lock, [] { return !g_IsAssetWorkerRunning || !g_DecodeJobs.empty(); });
+		if (!g_IsAssetWorkerRunning)
+		{
+			return;
+		}
+		DecodeJob job{ std::move(g_DecodeJobs.front()) };
+		g_DecodeJobs.pop_front();
+		lock.unlock();
+
+		DecodedImage image{ job.slot, job.generation };
+		DecodeImage(job.path, image);
+
+		lock.lock();
+		g_DecodedImages.push_back(std::move(image));
+	}
+}
+
+void CreateFallbackTexture()
+{
+	Uint8 pixels[g_FallbackSize * g_FallbackSize * 4]{};
+	for (int i = 0; i < g_FallbackSize; i++)
+	{
+		for (int j = 0; j < g_FallbackSize; j++)
+		{
+			Uint8* pPixel{ &pixels[(i * g_FallbackSize + j) * 4] };
+			bool isMagenta{ (i + j) % 2 == 0 };
+			pPixel[0] = isMagenta ? 255 : 0;
+			pPixel[2] = isMagenta ? 255 : 0;
+			pPixel[3] = 255;
+		}
+	}
+	glGenTextures(1, &g_FallbackTexture.id);
+	glBindTexture(GL_TEXTURE_2D, g_FallbackTexture.id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, g_FallbackSize, g_FallbackSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	g_FallbackTexture.width = float(g_FallbackSize);
+	g_FallbackTexture.height = float(g_FallbackSize);
+}
+
+void StartAssets()
+{
+	StopAssets();
+	CreateFallbackTexture();
+	g_IsAssetWorkerRunning = true;
+	g_AssetWorker = std::thread{ RunAssetWorker };
+}
+
+void StopAssets()
+{
+	if (!g_AssetWorker.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{ g_AssetMutex };
+		g_IsAssetWorkerRunning = false;
+		g_DecodeJobs.clear();
+	}
+	g_AssetSignal.notify_one();
+	g_AssetWorker.join();
+	g_DecodedImages.clear();
+
+	for (TextureSlot& slot : g_TextureSlots)
+	{
+		if (slot.state == TextureState::Ready && slot.nrReferences > 0)
+		{
+			glDeleteTextures(1, &slot.texture.id);
+		}
+	}
+	glDeleteTextures(1, &g_FallbackTexture.id);
+	g_FallbackTexture = Texture{};
+	g_TextureSlots.clear();
+	g_FreeTextureSlots.clear();
+	g_TexturesByPath.clear();
+	g_NrLoadingTextures = 0;
+}
+
+int AcquireTexture(const char* path, bool hasMipmaps)
+{
+	auto found{ g_TexturesByPath.find(path) };
+	if (found != g_TexturesByPath.end())
+	{
+		g_TextureSlots[found->second].nrReferences++;
+		return found->second;
+	}
+
+	int handle{};
+	if (g_FreeTextureSlots.empty())
+	{
+		handle = int(g_TextureSlots.size());
+		g_TextureSlots.push_back(TextureSlot{});
+	}
+	else
+	{
+		handle = g_FreeTextureSlots.back();
+		g_FreeTextureSlots.pop_back();
+	}
+	TextureSlot& slot{ g_TextureSlots[handle] };
+	slot.path = path;
+	slot.texture = Texture{};
+	slot.nrReferences = 1;
+	slot.state = TextureState::Loading;
+	slot.hasMipmaps = hasMipmaps;
+	g_TexturesByPath.emplace(slot.path, handle);
+	g_NrLoadingTextures++;
+
+	{
+		std::lock_guard<std::mutex> lock{ g_AssetMutex };
+		g_DecodeJobs.push_back(DecodeJob{ handle, slot.generation, slot.path });
+	}
+	g_AssetSignal.notify_one();
+	return handle;
+}
+
+void RetainTexture(int handle)
+{
+	if (handle != g_NoTexture)
+	{
+		g_TextureSlots[handle].nrReferences++;
+	}
+}
+
+void ReleaseTexture(int handle)
+{
+	if (handle == g_NoTexture)
+	{
+		return;
+	}
+	TextureSlot& slot{ g_TextureSlots[handle] };
+	if (--slot.nrReferences > 0)
+	{
+		return;
+	}
+
+	if (slot.state == TextureState::Ready)
+	{
+		glDeleteTextures(1, &slot.texture.id);
+	}
+	else if (slot.state == TextureState::Loading)
+	{
+		// No point decoding it anymore, an image already on its way is dropped by the generation
+		std::lock_guard<std::mutex> lock{ g_AssetMutex };
+		g_DecodeJobs.erase(std::remove_if(g_DecodeJobs.begin(), g_DecodeJobs.end(), [handle](const DecodeJob& job) { return job.slot == handle; }), g_DecodeJobs.end());
+		g_NrLoadingTextures--;
+	}
+	g_TexturesByPath.erase(slot.path);
+	slot.generation++;
+	slot.state = TextureState::Failed;
+	g_FreeTextureSlots.push_back(handle);
+}
+
+TextureState GetTextureState(int handle)
+{
+	return handle == g_NoTexture ? TextureState::Failed : g_TextureSlots[handle].state;
+}
+
+const Texture& GetTexture(int handle)
+{
+	if (handle == g_NoTexture || g_TextureSlots[handle].state != TextureState::Ready)
+	{
+		return g_FallbackTexture;
+	}
+	return g_TextureSlots[handle].texture;
+}
+
+void UploadImage(const DecodedImage& image)
+{
+	TextureSlot& slot{ g_TextureSlots[image.slot] };
+	if (slot.generation != image.generation)
+	{
+		return;
+	}
+	g_NrLoadingTextures--;
+	if (image.pixels.empty())
+	{
+		slot.state = TextureState::Failed;
+		return;
+	}
+
+	glGenTextures(1, &slot.texture.id);
+	glBindTexture(GL_TEXTURE_2D, slot.texture.id);
+	if (slot.hasMipmaps)
+	{
+		// Generated by the driver while the base level is uploaded, for textures drawn smaller than they are
+		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cerr << "Assets: could not upload " << slot.path << '\n';
+		glDeleteTextures(1, &slot.texture.id);
+		slot.texture = Texture{};
+		slot.state = TextureState::Failed;
+		return;
+	}
+	slot.texture.width = float(image.width);
+	slot.texture.height = float(image.height);
+	slot.state = TextureState::Ready;
+}
+
+void UploadTextures(float timeBudget)
+{
+	if (g_NrLoadingTextures == 0)
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+	while (true)
+	{
+		DecodedImage image{};
+		{
+			std::lock_guard<std::mutex> lock{ g_AssetMutex };
+			if (g_DecodedImages.empty())
+			{
+				return;
+			}
+			image = std::move(g_DecodedImages.front());
+			g_DecodedImages.pop_front();
+		}
+		UploadImage(image);
+		if (std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() >= timeBudget)
+		{
+			return;
+		}
+	}
+}
+
+int GetLoadingTextures()
+{
+	return g_NrLoadingTextures;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include "Structs.h"
+
+// Textures cached by path and shared through counted handles. Images are decoded on a worker thread and
+// uploaded on the thread that owns the GL context, within a time budget per frame, so loading never stalls a frame.
+// Until a texture is uploaded, and when it can't be loaded, its handle gives a checkerboard instead.
+const int g_NoTexture{ -1 };
+
+enum class TextureState : uint8_t
+{
+	Loading, Ready, Failed
+};
+
+// Call with the GL context current, only that thread may use the functions below
+void StartAssets();
+// Deletes every texture, released or not
+void StopAssets();
+
+// The same path gives the same handle while it has references, every acquire needs a release
+int AcquireTexture(const char* path, bool hasMipmaps = false);
+void RetainTexture(int handle);
+void ReleaseTexture(int handle);
+TextureState GetTextureState(int handle);
+const Texture& GetTexture(int handle);
+
+// Uploads decoded images until the budget is spent, at least one per call so loading always progresses
+void UploadTextures(float timeBudget);
+int GetLoadingTextures();
@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "CellBatch.h"
+#include "Structs.h"
+
+const Color4f g_BlockColors[g_NrBlockTypes + 1]
+{
+	{ 0.f, 0.f, 1.f, 1.f }, // Square
+	{ 1.f, 0.f, 0.f, 1.f }, // Line
+	{ 0.f, 1.f, 0.f, 1.f }, // zBlock
+	{ 1.f, 1.f, 0.f, 1.f }, // sBlock
+	{ 0.6f, 0.f, 0.8f, 1.f }, // tBlock
+	{ 1.f, 0.5f, 0.f, 1.f }, // lBlock
+	{ 0.f, 1.f, 1.f, 1.f }, // jBlock
+	{ 0.5f, 0.5f, 0.5f, 1.f } // Garbage
+};
+
+void AddCell(CellBatch& batch, float col, float row, int blockType, float left, float blockSize)
+{
+	const Color4f& color{ g_BlockColors[blockType] };
+	float x{ col * blockSize + left + blockSize };
+	float y{ (row + 1) * blockSize };
+
+	batch.vertices.push_back(CellVertex{ x, y, color.r, color.g, color.b }); //Bottom left
+	batch.vertices.push_back(CellVertex{ x + blockSize, y, color.r, color.g, color.b }); //Bottom Right
+	batch.vertices.push_back(CellVertex{ x + blockSize, y + blockSize, color.r, color.g, color.b }); //Top right
+	batch.vertices.push_back(CellVertex{ x, y + blockSize, color.r, color.g, color.b }); //Top left
+}
+
+void UpdateFills(CellBatch& batch, const Board& board, float left, float blockSize)
+{
+	if (batch.isBuilt && batch.boardRevision == board.revision && batch.left == left)
+	{
+		// Drop last frame's moving piece, the filled cells in front of it are still valid
+		batch.vertices.resize(batch.nrFilledVertices);
+		return;
+	}
+
+	batch.vertices.clear();
+	for (int i = 0; i < g_VisibleRows; i++)
+	{
+		for (int j = 0; j < g_BoardWidth; j++)
+		{
+			if (IsFilled(board, j, i))
+			{
+				AddCell(batch, float(j), float(i), GetColor(board, j, i), left, blockSize);
+			}
+		}
+	}
+	batch.nrFilledVertices = batch.vertices.size();
+	batch.boardRevision = board.revision;
+	batch.left = left;
+	batch.isBuilt = true;
+}
+
+void UpdateMoving(CellBatch& batch, const GameState& state, float fallOffset, float left, float blockSize)
+{
+	if (!state.isMoving)
+	{
+		return;
+	}
+
+	for (const PieceCell& cell : GetPieceMask(state.figure, state.rotation).cells)
+	{
+		int row{ state.y + cell.y };
+		if (row < g_VisibleRows)
+		{
+			AddCell(batch, float(state.x + cell.x), row - fallOffset, state.figure, left, blockSize);
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "GameState.h"
+
+// One corner of a cell quad, position and color interleaved so the whole array can be handed to OpenGL at once
+struct CellVertex
+{
+	float x, y;
+	float r, g, b;
+};
+
+// Quads for every cell on screen. The filled cells sit at the front of the array and are only rebuilt
+// when the board revision changes, the moving piece is appended behind them every frame.
+struct CellBatch
+{
+	std::vector<CellVertex> vertices;
+	size_t nrFilledVertices;
+	uint32_t boardRevision;
+	float left;
+	bool isBuilt;
+};
+
+void UpdateFills(CellBatch& batch, const Board& board, float left, float blockSize);
+void UpdateMoving(CellBatch& batch, const GameState& state, float fallOffset, float left, float blockSize);
@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "GlyphAtlas.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include <SDL_ttf.h>
+
+bool RasterizeGlyphs(GlyphAtlas& atlas, TTF_Font* pFont, std::vector<Uint8>& alpha, int& atlasHeight);
+void CopyGlyph(SDL_Surface* pGlyph, std::vector<Uint8>& alpha, int left, int top);
+
+bool LoadGlyphAtlas(GlyphAtlas& atlas, const char* fontPath, int ptSize)
+{
+	atlas = GlyphAtlas{};
+	TTF_Font* pFont{ TTF_OpenFont(fontPath, ptSize) };
+	if (pFont == nullptr)
+	{
+		std::cerr << "LoadGlyphAtlas: could not open " << fontPath << ": " << TTF_GetError() << '\n';
+		return false;
+	}
+	std::vector<Uint8> alpha{};
+	int atlasHeight{};
+	bool isRasterized{ RasterizeGlyphs(atlas, pFont, alpha, atlasHeight) };
+	atlas.lineHeight = float(TTF_FontHeight(pFont));
+	TTF_CloseFont(pFont);
+	if (!isRasterized)
+	{
+		return false;
+	}
+
+	// The color comes from the vertices, the texture only has the coverage
+	glGenTextures(1, &atlas.textureId);
+	glBindTexture(GL_TEXTURE_2D, atlas.textureId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, g_AtlasWidth, atlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, alpha.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	return true;
+}
+
+bool RasterizeGlyphs(GlyphAtlas& atlas, TTF_Font* pFont, std::vector<Uint8>& alpha, int& atlasHeight)
+{
+	// Glyphs go in rows from the top left, a new row starts when one doesn't fit anymore.
+	// Every glyph surface is as high as the font with the baseline at the ascent.
+	const SDL_Color white{ 255, 255, 255, 255 };
+	const int padding{ 1 }; // keeps neighbours from bleeding in
+	int ascent{ TTF_FontAscent(pFont) };
+	int x{ padding }, y{ padding }, rowHeight{};
+	std::vector<SDL_Surface*> surfaces(g_NrGlyphs, nullptr);
+	for (int i = 0; i < g_NrGlyphs; i++)
+	{
+		SDL_Surface* pRendered{ TTF_RenderGlyph_Blended(pFont, Uint16(g_FirstGlyph + i), white) };
+		if (pRendered == nullptr)
+		{
+			continue;
+		}
+		surfaces[i] = SDL_ConvertSurfaceFormat(pRendered, SDL_PIXELFORMAT_RGBA32, 0);
+		SDL_FreeSurface(pRendered);
+		if (surfaces[i] == nullptr)
+		{
+			continue;
+		}
+		int width{ surfaces[i]->w }, height{ surfaces[i]->h };
+		if (x + width + padding > g_AtlasWidth)
+		{
+			x = padding;
+			y += rowHeight + padding;
+			rowHeight = 0;
+		}
+		int minX{}, maxX{}, minY{}, maxY{}, advance{};
+		TTF_GlyphMetrics(pFont, Uint16(g_FirstGlyph + i), &minX, &maxX, &minY, &maxY, &advance);
+		// Texture coordinates are filled in once the height of the atlas is known
+		atlas.glyphs[i] = Glyph{ 0.f, float(ascent - height), float(width), float(height), float(x), float(y), float(x + width), float(y + height), float(advance) };
+		x += width + padding;
+		rowHeight = std::max(rowHeight, height);
+	}
+
+	// Round up to a power of two, older drivers want that
+	atlasHeight = 1;
+	while (atlasHeight < y + rowHeight + padding)
+	{
+		atlasHeight *= 2;
+	}
+	alpha.assign(size_t(g_AtlasWidth) * atlasHeight, 0);
+	bool isComplete{ true };
+	for (int i = 0; i < g_NrGlyphs; i++)
+	{
+		Glyph& glyph{ atlas.glyphs[i] };
+		if (surfaces[i] == nullptr)
+		{
+			isComplete = false;
+			continue;
+		}
+		CopyGlyph(surfaces[i], alpha, int(glyph.u0), int(glyph.v0));
+		SDL_FreeSurface(surfaces[i]);
+		// The top row of the image is the first row of the texture, so v grows downwards like the pixel rows
+		glyph.u0 /= g_AtlasWidth;
+		glyph.u1 /= g_AtlasWidth;
+		glyph.v0 /= atlasHeight;
+		glyph.v1 /= atlasHeight;
+	}
+	if (!isComplete)
+	{
+		std::cerr << "LoadGlyphAtlas: could not render every glyph: " << TTF_GetError() << '\n';
+	}
+	return true;
+}
+
+void CopyGlyph(SDL_Surface* pGlyph, std::vector<Uint8>& alpha, int left, int top)
+{
+	// RGBA32 has the bytes in that order whatever the endianness
+	for (int i = 0; i < pGlyph->h; i++)
+	{
+		const Uint8* pRow{ static_cast<const Uint8*>(pGlyph->pixels) + i * pGlyph->pitch };
+		Uint8* pTarget{ &alpha[size_t(top + i) * g_AtlasWidth + left] };
+		for (int j = 0; j < pGlyph->w; j++)
+		{
+			pTarget[j] = pRow[j * 4 + 3];
+		}
+	}
+}
+
+void DeleteGlyphAtlas(GlyphAtlas& atlas)
+{
+	if (atlas.textureId != 0)
+	{
+		glDeleteTextures(1, &atlas.textureId);
+	}
+	atlas = GlyphAtlas{};
+}
+
+float GetTextWidth(const GlyphAtlas& atlas, const char* text)
+{
+	float width{};
+	for (const char* pChar = text; *pChar != '\0'; pChar++)
+	{
+		int index{ int(Uint8(*pChar)) - g_FirstGlyph };
+		if (index >= 0 && index < g_NrGlyphs)
+		{
+			width += atlas.glyphs[index].advance;
+		}
+	}
+	return width;
+}
+
+void AddText(TextBatch& batch, const GlyphAtlas& atlas, const char* text, float x, float y, const Color4f& color)
+{
+	float penX{ std::round(x) };
+	float penY{ std::round(y) };
+	for (const char* pChar = text; *pChar != '\0'; pChar++)
+	{
+		int index{ int(Uint8(*pChar)) - g_FirstGlyph };
+		if (index < 0 || index >= g_NrGlyphs)
+		{
+			continue;
+		}
+		const Glyph& glyph{ atlas.glyphs[index] };
+		if (*pChar != ' ' && glyph.width > 0.f)
+		{
+			float left{ penX + glyph.left };
+			float bottom{ penY + glyph.bottom };
+			float right{ left + glyph.width };
+			float top{ bottom + glyph.height };
+			batch.vertices.push_back(TextVertex{ left, bottom, glyph.u0, glyph.v1, color.r, color.g, color.b, color.a });
+			batch.vertices.push_back(TextVertex{ left, top, glyph.u0, glyph.v0, color.r, color.g, color.b, color.a });
+			batch.vertices.push_back(TextVertex{ right, top, glyph.u1, glyph.v0, color.r, color.g, color.b, color.a });
+			batch.vertices.push_back(TextVertex{ right, bottom, glyph.u1, glyph.v1, color.r, color.g, color.b, color.a });
+		}
+		penX += glyph.advance;
+	}
+}
+
+void DrawTextBatch(TextBatch& batch, const GlyphAtlas& atlas)
+{
+	if (batch.vertices.empty())
+	{
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, atlas.textureId);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glEnable(GL_TEXTURE_2D);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(TextVertex), &batch.vertices[0].x);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(TextVertex), &batch.vertices[0].u);
+	glColorPointer(4, GL_FLOAT, sizeof(TextVertex), &batch.vertices[0].r);
+	glDrawArrays(GL_QUADS, 0, GLsizei(batch.vertices.size()));
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisable(GL_TEXTURE_2D);
+	batch.vertices.clear();
+}
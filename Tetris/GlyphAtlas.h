@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "Structs.h"
+
+// Printable ASCII of one font at one size, rasterized once into a single texture when the font is loaded.
+// Strings become one quad per glyph from that texture, collected in a batch and drawn with one call,
+// so text that changes every frame costs no file access, surface or texture upload.
+const int g_FirstGlyph{ 32 }; // space
+const int g_NrGlyphs{ 95 }; // up to and including '~', other characters are skipped
+const int g_AtlasWidth{ 512 }; // pixels, the height is what the glyphs need
+
+struct Glyph
+{
+	float left, bottom; // of the quad, from the pen on the baseline
+	float width, height;
+	float u0, v0, u1, v1;
+	float advance;
+};
+
+struct GlyphAtlas
+{
+	unsigned int textureId; // GLuint, only alpha
+	float lineHeight;
+	Glyph glyphs[g_NrGlyphs];
+};
+
+struct TextVertex
+{
+	float x, y;
+	float u, v;
+	float r, g, b, a;
+};
+
+struct TextBatch
+{
+	std::vector<TextVertex> vertices;
+};
+
+bool LoadGlyphAtlas(GlyphAtlas& atlas, const char* fontPath, int ptSize);
+void DeleteGlyphAtlas(GlyphAtlas& atlas);
+float GetTextWidth(const GlyphAtlas& atlas, const char* text);
+// Starts at x on the baseline y, snapped to whole pixels so the glyphs stay sharp
+void AddText(TextBatch& batch, const GlyphAtlas& atlas, const char* text, float x, float y, const Color4f& color);
+// Draws everything added since the last call and empties the batch
+void DrawTextBatch(TextBatch& batch, const GlyphAtlas& atlas);
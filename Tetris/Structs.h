@@ -21,11 +21,9 @@ struct Color4f
 	float a;
 };
 
-
-struct Block
+struct Texture
 {
-	int x, y, blockType;
-	bool isFilled;
-	bool isMoving;
-	bool stateLine;
-};
\ No newline at end of file
+	unsigned int id; // GLuint
+	float width;
+	float height;
+};
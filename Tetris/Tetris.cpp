@@ -2,6 +2,7 @@
 #include "pch.h"
 
 #pragma region generalDirectives
+#ifdef _MSC_VER
 // SDL libs
 #pragma comment(lib, "sdl2.lib")
 #pragma comment(lib, "SDL2main.lib")
@@ -13,11 +14,12 @@
 // SDL extension libs 
 #pragma comment(lib, "SDL2_image.lib") // Library to load image files
 #pragma comment(lib, "SDL2_ttf.lib") // Library to use fonts
+#endif
 
 // SDL and OpenGL Includes
 #include <SDL.h>
 #include <SDL_opengl.h>
-#include <GL\GLU.h>
+#include <GL/glu.h>
 
 #include <SDL_image.h> // png loading
 #include <SDL_ttf.h> // Font
@@ -26,9 +28,23 @@
 #include <iostream>
 #include <string>
 #include <ctime>
+#include <cerrno>
+#include <cstdlib>
 #include <chrono>
-
-#include "structs.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "Structs.h"
+#include "GameState.h"
+#include "CellBatch.h"
+#include "GlyphAtlas.h"
+#include "Assets.h"
+#include "Trace.h"
+#include "BeamSearch.h"
+#include "Replay.h"
+#include "Input.h"
+#include "Profiler.h"
 
 #pragma region windowInformation
 const float g_WindowWidth{ 1280.0f };
@@ -38,26 +54,16 @@ bool g_IsVSyncOn{ true };
 #pragma endregion windowInformation
 
 #pragma region textureDeclarations
-struct Texture
-{
-	GLuint id;
-	float width;
-	float height;
-};
-
-bool TextureFromFile(const std::string& path, Texture & texture);
-bool TextureFromString(const std::string & text, TTF_Font *pFont, const Color4f & textColor, Texture & texture);
-bool TextureFromString(const std::string & text, const std::string& fontPath, int ptSize, const Color4f & textColor, Texture & texture);
-void TextureFromSurface(const SDL_Surface *pSurface, Texture & textureData);
 void DrawTexture(const Texture & texture, const Point2f& bottomLeftVertex, const Rectf & sourceRect = {});
 void DrawTexture(const Texture & texture, const Rectf & destinationRect, const Rectf & sourceRect = {});
-void DeleteTexture(Texture & texture);
 #pragma endregion textureDeclarations
 
 #pragma region coreDeclarations
 // Functions
 void Initialize( );
 void Run( );
+bool ParseArguments(int argc, char* args[]);
+void PrintUsage();
 void Cleanup( );
 void QuitOnSDLError( );
 void QuitOnOpenGlError( );
@@ -68,7 +74,7 @@ void QuitOnTtfError();
 SDL_Window* g_pWindow{ nullptr }; // The window we'll be rendering to
 SDL_GLContext g_pContext; // OpenGL context
 Uint32 g_MilliSeconds{};
-const Uint32 g_MaxElapsedTime{ 100 };
+const float g_MaxElapsedTime{ 0.1f }; // seconds
 #pragma endregion coreDeclarations
 
 #pragma region gameDeclarations
@@ -84,44 +90,86 @@ void ProcessMouseMotionEvent(const SDL_MouseMotionEvent & e);
 void ProcessMouseDownEvent(const SDL_MouseButtonEvent & e);
 void ProcessMouseUpEvent(const SDL_MouseButtonEvent & e);
 void DrawGrid();
-void BlockUpdate();
-void DrawBlock(float x, float y, int blockType);
-void MoveSquare(Block *pMoving, int bTypes);
-void FillSquare(Block *pMoving, int bTypes);
-void MoveLine(bool stateLine, Block *pMoving, int bTypes);
-void FillLine(bool stateLine, Block *pMoving, int bTypes);
-void MoveZ(Block *pMoving, bool stateZ, int bTypes);
-void FillZ(Block *pFilled, bool stateZ, int bTypes);
-void GridFill(int nrCols, Block *pFilled);
-void ConsoleGrid(Block *pFilled);
-void DrawFills(Block *pFilled);
-void DrawMoving(Block *pMoving);
+void SwapLayout();
+void DrawFills(const Board& board);
+void DrawMoving(const GameState& state);
+void DrawCells();
+void SeekPlayback(int nrSteps);
+uint64_t GetEventTime(Uint32 timestamp);
+void MeasureLatency();
+void PrintLatency();
+void ToggleProfiler();
+void DrawProfiler();
+void AddOverlayQuad(float left, float bottom, float width, float height, const Color4f& color);
+void LoadHudFont();
+void DrawHud();
 
 // Variables
-Texture g_Grid{};
-float g_Left{ 400.f };
+// The layout is a texture handle from the asset manager, L loads the next one while the current one stays on screen
+const char* const g_LayoutPaths[]{ "Resources/Layout.png", "Resources/Layout.jpg" };
+const int g_NrLayouts{ 2 };
+const float g_LayoutWidth{ 480.f };
+const float g_LayoutHeight{ 720.f };
+const float g_AssetTimeBudget{ 0.002f }; // seconds of texture uploads per frame
+int g_Layout{};
+int g_Grid{ g_NoTexture };
+int g_NextGrid{ g_NoTexture }; // replaces g_Grid once it's done loading
+float g_Left{ (g_WindowWidth - g_LayoutWidth) / 2 };
 const float g_BlockSize(40.f);
-const int g_GridSize{ 160 };
-Block g_GridArray[g_GridSize];
-int g_Counter{ 0 };
-bool g_Moving{false};
-float g_X{}, g_Y{};
-const int g_NrCols{ 10 };
-int g_Figure{ 7 };
-bool g_StateLine{ false }; //Line false --> down true --> up
-int g_Index{};
+GameState g_State{};
+CellBatch g_Cells{};
+uint8_t g_Input{ InputNone }; // presses of this frame, applied before it is drawn
+AutoRepeat g_Repeat{};
+float g_StepTime{}; // Steps the simulation still owes, the fraction is used to interpolate the moving piece
 int g_BlocksUsed{};
-enum class BlockTypes
-{
-	Square, Line, zBlock
-};
+uint64_t g_Seed{ uint64_t(time(nullptr)) };
+bool g_IsAiPlaying{ false }; // toggled with A, the beam search then places every piece
+BeamSearch g_Search{};
+const float g_AiTimeBudget{ 0.004f }; // seconds per piece, well within a frame
+Replay g_Replay{};
+const char* g_pRecordPath{ nullptr }; // the game is saved there when the window closes
+bool g_IsRecording{ false };
+bool g_IsReplaying{ false }; // the loaded replay plays instead of the keyboard, left and right seek
+ReplayPlayer g_Player{};
+const int g_SeekSteps{ 5 * g_StepsPerSecond };
+// Input to photon latency: every press is timestamped when SDL got it and measured once the frame that shows it
+// is swapped. --latency waits for the swap to finish and prints a summary when the window closes.
+bool g_IsMeasuringLatency{ false };
+std::vector<uint64_t> g_PressTimes{}; // performance counter, of the presses the next swap shows
+std::vector<float> g_Latencies{}; // milliseconds
+// F3 shows the last frames split into their outermost zones and a histogram of frame times with the median,
+// 95th and 99th percentile marked. --profile trace.json captures every zone.
+bool g_IsShowingProfiler{ false };
+const char* g_pProfilePath{ nullptr };
+std::vector<CellVertex> g_OverlayVertices{};
+const float g_GraphScale{ 4.f }; // pixels per millisecond
+const float g_BucketWidth{ 6.f }; // pixels
+const float g_HistogramHeight{ 80.f };
+const Color4f g_SlotColors[g_FrameSlots]{ { 0.9f, 0.6f, 0.2f, 1.f }, { 0.3f, 0.7f, 1.f, 1.f }, { 0.4f, 0.9f, 0.4f, 1.f },
+	{ 0.9f, 0.3f, 0.8f, 1.f }, { 1.f, 0.9f, 0.3f, 1.f }, { 0.3f, 0.9f, 0.9f, 1.f }, { 0.9f, 0.3f, 0.3f, 1.f }, { 0.6f, 0.5f, 1.f, 1.f } };
+// Score, lines and pieces next to the playfield, the font is loaded once and every string drawn from its atlas
+const char* const g_FontPaths[]{ "Resources/Font.ttf", "C:/Windows/Fonts/arial.ttf", "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf" };
+const int g_HudFontSize{ 28 };
+const int g_SmallFontSize{ 14 };
+GlyphAtlas g_HudFont{};
+GlyphAtlas g_SmallFont{};
+TextBatch g_HudText{};
+TextBatch g_SmallText{};
+bool g_IsHudFontLoaded{ false };
 #pragma endregion gameDeclarations
 
 
 int main( int argc, char* args[] )
 {
-	// seed the pseudo random number generator
-	srand(unsigned int(time(nullptr)));	
+	// Optional seed and debug trace, e.g. --seed 42 --trace boards --trace-binary --trace-file trace.bin
+	// and recording or playing back a game with --record game.replay or --replay game.replay.
+	// --latency measures the time from each key press until the frame showing it is swapped.
+	// --profile trace.json writes every profiled zone as a Chrome trace, F3 shows the frame time overlay.
+	if (!ParseArguments(argc, args))
+	{
+		PrintUsage();
+		return 1;
+	}
 	
 	// Initialize SDL and OpenGL
 	Initialize( );
@@ -138,69 +186,94 @@ int main( int argc, char* args[] )
 #pragma region gameImplementations
 void InitGameResources()
 {
-	TextureFromFile("Resources/Layout.png", g_Grid);
+	StartAssets();
+	g_Grid = AcquireTexture(g_LayoutPaths[g_Layout]);
+	LoadHudFont();
+
+	// One thread is left for the game itself
+	SearchSettings settings{ g_DefaultSearch };
+	settings.nrThreads = std::max(1, int(std::thread::hardware_concurrency()) - 1);
+	settings.timeBudget = g_AiTimeBudget;
+	InitBeamSearch(g_Search, settings);
 }
 
 void FreeGameResources()
 {
-	DeleteTexture(g_Grid);
+	ReleaseTexture(g_Grid);
+	ReleaseTexture(g_NextGrid);
+	StopAssets();
+	DeleteGlyphAtlas(g_HudFont);
+	DeleteGlyphAtlas(g_SmallFont);
+}
+
+void LoadHudFont()
+{
+	for (const char* pPath : g_FontPaths)
+	{
+		if (LoadGlyphAtlas(g_HudFont, pPath, g_HudFontSize) && LoadGlyphAtlas(g_SmallFont, pPath, g_SmallFontSize))
+		{
+			g_IsHudFontLoaded = true;
+			return;
+		}
+		DeleteGlyphAtlas(g_HudFont);
+	}
+	std::cout << "No font found, put one in Resources/Font.ttf to see the score" << std::endl;
 }
 
 void ProcessKeyDownEvent(const SDL_KeyboardEvent  & e)
 {
+	if (e.keysym.sym == SDLK_F3 && !e.repeat)
+	{
+		ToggleProfiler();
+		return;
+	}
+	if (g_IsReplaying)
+	{
+		if (e.keysym.sym == SDLK_LEFT)
+		{
+			SeekPlayback(-g_SeekSteps);
+		}
+		else if (e.keysym.sym == SDLK_RIGHT)
+		{
+			SeekPlayback(g_SeekSteps);
+		}
+		return;
+	}
+
+	// The OS repeats a held key, the game only wants the press and repeats moves itself
+	if (e.repeat)
+	{
+		return;
+	}
+	g_PressTimes.push_back(GetEventTime(e.timestamp));
+
 	switch (e.keysym.sym)
 	{
 	case SDLK_UP:
-		g_StateLine = !g_StateLine;
+		g_Input |= InputRotateCW;
+		break;
+	case SDLK_z:
+		g_Input |= InputRotateCCW;
+		break;
+	case SDLK_SPACE:
+		g_Input |= InputHardDrop;
 		break;
 	case SDLK_LEFT:
-		if (g_X >0)
-		{
-			g_X--;
-		}
+		g_Input |= InputLeft;
+		PressDirection(g_Repeat, InputLeft);
 		break;
 	case SDLK_RIGHT:
-		BlockTypes bTypes{ BlockTypes(g_Figure) };
-		switch (bTypes)
-		{
-		case BlockTypes::Square:
-			if (g_X < 8 && g_GridArray[g_Index+2].isFilled == false)
-			{
-				g_X++;
-			}
-			break;
-		case BlockTypes::Line:
-			if (g_StateLine)
-			{
-				if (g_X < 9)
-				{
-					g_X++;
-				}
-			}
-			else
-			{
-				if (g_X < 6)
-				{
-					g_X++;
-				}
-			}
-		case BlockTypes::zBlock:
-			if (g_StateLine)
-			{
-				if (g_X < 9)
-				{
-					g_X++;
-				}
-			}
-			else
-			{
-				if (g_X < 7)
-				{
-					g_X++;
-				}
-			}
-		}
-		
+		g_Input |= InputRight;
+		PressDirection(g_Repeat, InputRight);
+		break;
+	case SDLK_a:
+		g_IsAiPlaying = !g_IsAiPlaying;
+		break;
+	case SDLK_l:
+		// A layout still loading is given up for the one after it
+		ReleaseTexture(g_NextGrid);
+		g_Layout = (g_Layout + 1) % g_NrLayouts;
+		g_NextGrid = AcquireTexture(g_LayoutPaths[g_Layout]);
 		break;
 	}
 }
@@ -210,10 +283,10 @@ void ProcessKeyUpEvent(const SDL_KeyboardEvent  & e)
 	switch (e.keysym.sym)
 	{
 	case SDLK_LEFT:
-		//std::cout << "Left arrow key released\n";
+		ReleaseDirection(g_Repeat, InputLeft);
 		break;
 	case SDLK_RIGHT:
-		//std::cout << "`Right arrow key released\n";
+		ReleaseDirection(g_Repeat, InputRight);
 		break;
 	case SDLK_1:
 	case SDLK_KP_1:
@@ -255,410 +328,359 @@ void ProcessMouseUpEvent(const SDL_MouseButtonEvent & e)
 
 void Update( float elapsedSec )
 {
-	BlockUpdate();
+	PROFILE_ZONE("Update");
 
-}
-
-void DrawGrid()
-{
-	g_Left = (g_WindowWidth / 2) - (g_Grid.width / 2);
-	Rectf destRect;
-	destRect.left = g_Left;
-	destRect.width = g_Grid.width;
-	destRect.height = g_Grid.height;
-	destRect.bottom = 0.0f;
+	// The simulation runs at a fixed rate no matter how fast frames are drawn
+	g_StepTime += elapsedSec * g_StepsPerSecond;
+	int nrSteps{ int(g_StepTime) };
+	g_StepTime -= nrSteps;
 
-	DrawTexture(g_Grid, destRect);
-}
+	if (g_IsReplaying)
+	{
+		PlayReplay(g_Player, uint32_t(g_State.counter + nrSteps));
+		g_State = g_Player.position.state;
+		return;
+	}
 
-void DrawFills(Block *pFilled)
-{
-	for (int i = 0; i < g_GridSize; i++)
+	// Presses move the piece in the frame they came in, whether a step is due or not
+	if (g_Input != InputNone)
 	{
-		if (pFilled[i].isFilled)
+		if (g_IsRecording)
 		{
-			DrawBlock(float(pFilled[i].x), float(pFilled[i].y), pFilled[i].blockType);
+			RecordInput(g_Replay, g_State, g_Input);
 		}
+		ApplyInput(g_State, g_Input);
+		g_Input = InputNone;
 	}
 
-	int nrRows{ g_GridSize / g_NrCols };
-	int counterColFilled{};
-	int removeCounter{};
-
-	for (int i = 0; i < nrRows; i++)
+	if (g_Repeat.direction == InputNone)
 	{
-		for (int j = 0; j < g_NrCols; j++)
+		// Without a held key nothing happens until the next drop, so those steps can be skipped at once
+		int nrIdleSteps{ std::min(nrSteps, StepsUntilDrop(g_State)) };
+		SkipSteps(g_State, nrIdleSteps);
+		nrSteps -= nrIdleSteps;
+	}
+	PROFILE_ZONE("Step");
+	for (int i = 0; i < nrSteps; i++)
+	{
+		uint8_t input{ StepAutoRepeat(g_Repeat) };
+		if (g_IsRecording)
+		{
+			RecordInput(g_Replay, g_State, input);
+		}
+		Step(g_State, input);
+
+		if (g_State.blocksUsed != g_BlocksUsed)
 		{
-			int index = i * 10 + j;
-			if (pFilled[index].isFilled)
+			g_BlocksUsed = g_State.blocksUsed;
+			TraceBoard(g_State.counter, g_State.board);
+			if (g_State.isGameOver)
 			{
-				pFilled[index].isFilled = false;
-				pFilled[index - (removeCounter * 10)].isFilled = true;
-				counterColFilled++;
+				TraceGameOver(g_State.counter);
+			}
+			else
+			{
+				TraceSpawn(g_State.counter, g_State.figure);
 			}
 		}
-		if (counterColFilled == g_NrCols)
+		if (g_IsAiPlaying && g_State.isMoving)
 		{
-			for (int j = 0; j < g_NrCols; j++)
+			PROFILE_ZONE("Search");
+			// When the piece can't go anywhere the search leaves it where it is, and gravity takes it from there
+			Placement placement{ FindBestPlacement(g_Search, g_State) };
+			if (CanPlace(g_State, placement))
 			{
-				int index = i * 10 + j;
-				pFilled[index].isFilled = false;
+				if (g_IsRecording)
+				{
+					RecordPlacement(g_Replay, g_State, placement);
+				}
+				ApplyPlacement(g_State, placement);
 			}
-			removeCounter++;
 		}
-		counterColFilled = 0;
 	}
 }
 
-void DrawMoving(Block *pMoving)
+void SeekPlayback(int nrSteps)
 {
-	for (int i = 0; i < g_GridSize; i++)
+	int step{ std::max(0, g_State.counter + nrSteps) };
+	SeekReplay(g_Player, uint32_t(step));
+	g_State = g_Player.position.state;
+}
+
+uint64_t GetEventTime(Uint32 timestamp)
+{
+	// SDL stamps events in milliseconds, the time the event waited is taken off the finer counter
+	uint64_t now{ SDL_GetPerformanceCounter() };
+	uint64_t waited{ uint64_t(SDL_GetTicks() - timestamp) * SDL_GetPerformanceFrequency() / 1000 };
+	return waited < now ? now - waited : now;
+}
+
+void MeasureLatency()
+{
+	if (g_PressTimes.empty())
+	{
+		return;
+	}
+	if (g_IsMeasuringLatency)
 	{
-		if (pMoving[i].isMoving)
+		// The swap can return before the frame is on its way to the screen
+		glFinish();
+		uint64_t now{ SDL_GetPerformanceCounter() };
+		float frequency{ float(SDL_GetPerformanceFrequency()) };
+		for (uint64_t pressTime : g_PressTimes)
 		{
-			DrawBlock(float(pMoving[i].x), float(pMoving[i].y), pMoving[i].blockType);
+			g_Latencies.push_back((now - pressTime) * 1000.f / frequency);
 		}
 	}
+	g_PressTimes.clear();
 }
 
-void GridFill(int nrCols, Block *pFilled)
+void PrintLatency()
 {
-	for (int i = 0; i < g_GridSize; i++)
+	if (g_Latencies.empty())
 	{
-		pFilled[i].x = i % 10; // 10 cols x rangin from 0 to 9
-		pFilled[i].y = (i) / 10; // 16 rows y ranging from 0 to 15. Starting from 0 every 10 indexes +1
-		g_Index = pFilled[i].y * 10 + pFilled[i].x;
+		return;
 	}
+	std::sort(g_Latencies.begin(), g_Latencies.end());
+	float total{};
+	for (float latency : g_Latencies)
+	{
+		total += latency;
+	}
+	size_t nrPresses{ g_Latencies.size() };
+	std::cout << "Input to photon over " << nrPresses << " presses: mean " << total / nrPresses << " ms, median "
+		<< g_Latencies[nrPresses / 2] << " ms, 95th percentile " << g_Latencies[nrPresses * 95 / 100] << " ms, max "
+		<< g_Latencies.back() << " ms" << std::endl;
 }
 
-void ConsoleGrid(Block *pFilled)
+void ToggleProfiler()
 {
-	int nrRows{ g_GridSize / g_NrCols };
-	for (int i = 0; i < nrRows; i++)
+	g_IsShowingProfiler = !g_IsShowingProfiler;
+	if (g_IsShowingProfiler)
 	{
-		std::cout << std::endl;
-		for (int j = 0; j < g_NrCols; j++)
+		if (!g_IsProfiling)
 		{
-			int idx = (i*10) + j;
-			std::cout << pFilled[idx].isFilled << " ";
+			StartProfiler(nullptr);
 		}
+		return;
+	}
+	// A trace being captured keeps running until the game closes
+	if (!IsCapturingTrace())
+	{
+		StopProfiler();
 	}
 }
 
-void BlockUpdate()
+void DrawProfiler()
 {
-	//std::cout << g_Counter << std::endl;
-	if (g_Counter % 10 == 0)
+	PROFILE_ZONE("DrawProfiler");
+	const float left{ 10.f };
+	const float graphHeight{ g_HistogramBuckets * g_GraphScale };
+	const float graphBottom{ g_WindowHeight - 10.f - graphHeight };
+	const float histogramBottom{ graphBottom - 10.f - g_HistogramHeight };
+	const float histogramWidth{ g_HistogramBuckets * g_BucketWidth };
+	const Color4f grey{ 0.6f, 0.6f, 0.6f, 1.f };
+	const Color4f white{ 1.f, 1.f, 1.f, 1.f };
+
+	glColor4f(0.f, 0.f, 0.f, 0.6f);
+	glRectf(left - 5.f, histogramBottom - 5.f, left + std::max(float(g_FrameHistory), histogramWidth) + 5.f, graphBottom + graphHeight + 5.f);
+
+	// The last frames from left to right, stacked from the outermost zones, what no zone covers in grey
+	g_OverlayVertices.clear();
+	for (int i = 0; i < g_FrameHistory; i++)
 	{
-		if (g_Moving)
-		{
-			for (int i = 0; i < g_GridSize; i++)
-			{
-				g_GridArray[i].isMoving = false;
-			}
-
-			g_Index = int(g_Y * 10 + g_X);
-
-			int Indexes[4];
-			BlockTypes bTypes{ BlockTypes(g_Figure) };
-			switch (bTypes)
-			{
-			case BlockTypes::Square:
-				Indexes[0] = g_Index;
-				Indexes[1] = g_Index + 1;
-				Indexes[2] = g_Index + 10;
-				Indexes[3] = g_Index + 11;
-				break;
-			case BlockTypes::Line:
-				if (g_StateLine)
-				{
-					Indexes[0] = g_Index;
-					Indexes[1] = g_Index + 10;
-					Indexes[2] = g_Index + 20;
-					Indexes[3] = g_Index + 30;
-
-				}
-				else
-				{
-					Indexes[0] = g_Index;
-					Indexes[1] = g_Index + 1;
-					Indexes[2] = g_Index + 2;
-					Indexes[3] = g_Index + 3;
-				}
-				break;
-			case BlockTypes::zBlock:
-				if (g_StateLine)
-				{
-
-					Indexes[0] = g_Index;
-					Indexes[1] = g_Index + 10;
-					Indexes[2] = g_Index + 9;
-					Indexes[3] = g_Index + 19;
-				}
-				else
-				{
-
-					Indexes[0] = g_Index;
-					Indexes[1] = g_Index + 1;
-					Indexes[2] = g_Index + 11;
-					Indexes[3] = g_Index + 12;
-				}
-			}
-			if (g_Y > 0 && g_GridArray[Indexes[0]].isMoving == g_GridArray[Indexes[0] -10].isFilled && g_GridArray[Indexes[1]].isMoving == g_GridArray[Indexes[1] - 10].isFilled && g_GridArray[Indexes[2]].isMoving == g_GridArray[Indexes[2] - 10].isFilled && g_GridArray[Indexes[3]].isMoving == g_GridArray[Indexes[3] - 10].isFilled)
-			{
-				g_Y--;
-				switch (bTypes)
-				{
-				case BlockTypes::Square:
-					MoveSquare(g_GridArray, int(bTypes));
-					break;
-
-				case BlockTypes::Line:
-					MoveLine(g_StateLine, g_GridArray, int(bTypes));
-					break;
-				case BlockTypes::zBlock:
-					MoveZ(g_GridArray, g_StateLine, int(bTypes));
-				}
-			}
-			else
-			{
-				switch (bTypes)
-				{
-				case BlockTypes::Square:
-					FillSquare(g_GridArray, int(bTypes));
-					break;
-				case BlockTypes::Line:
-					FillLine(g_StateLine, g_GridArray, int(bTypes));
-					break;
-				case BlockTypes::zBlock:
-					FillZ(g_GridArray, g_StateLine, int(bTypes));
-				}
-				g_Moving = false;
-			}
-			
-		}
-		else
+		const ProfileFrame& frame{ GetProfileFrame(i) };
+		float milliseconds{ std::min(frame.milliseconds, float(g_HistogramBuckets)) };
+		float bottom{ graphBottom };
+		for (int j = 0; j < g_FrameSlots; j++)
 		{
-			g_Figure = rand() % 3;
-			g_BlocksUsed++;
-			ConsoleGrid(g_GridArray);
-			std::cout << std::endl << g_Figure << std::endl;
-			BlockTypes bTypes{ BlockTypes(g_Figure) };
-			switch (bTypes)
+			float height{ std::min(frame.slots[j] * g_GraphScale, graphBottom + milliseconds * g_GraphScale - bottom) };
+			if (height > 0.f)
 			{
-			case BlockTypes::Square:
-				g_X = 4;
-				g_Y = 14;
-				g_Index = int(g_Y * 10 + g_X);
-				MoveSquare(g_GridArray, int(bTypes));
-				break;
-			case BlockTypes::Line:
-				g_X = 3;
-				g_Y = 15;
-				g_Index = int(g_Y * 10 + g_X);
-				g_StateLine = false;
-				MoveLine(g_StateLine, g_GridArray, int(bTypes));
-				break;
-			case BlockTypes::zBlock:
-				g_X = 4;
-				g_Y = 14;
-				g_Index = int(g_Y * 10 + g_X);
-				g_StateLine = false;
-				MoveZ(g_GridArray, g_StateLine, int(bTypes));
-				break;
+				AddOverlayQuad(left + i, bottom, 1.f, height, g_SlotColors[j]);
+				bottom += height;
 			}
-			g_Moving = true;
 		}
+		AddOverlayQuad(left + i, bottom, 1.f, graphBottom + milliseconds * g_GraphScale - bottom, grey);
+	}
+	// 60 and 30 frames per second
+	AddOverlayQuad(left, graphBottom + 1000.f / 60.f * g_GraphScale, float(g_FrameHistory), 1.f, white);
+	AddOverlayQuad(left, graphBottom + 1000.f / 30.f * g_GraphScale, float(g_FrameHistory), 1.f, white);
+
+	// How many frames took how long, in buckets of a millisecond, with the percentiles as lines
+	FrameTimes times{};
+	GetFrameTimes(times);
+	int maxCount{ *std::max_element(times.histogram, times.histogram + g_HistogramBuckets) };
+	for (int i = 0; i < g_HistogramBuckets && maxCount > 0; i++)
+	{
+		float height{ times.histogram[i] * g_HistogramHeight / maxCount };
+		AddOverlayQuad(left + i * g_BucketWidth, histogramBottom, g_BucketWidth - 1.f, height, grey);
+	}
+	const float percentiles[]{ times.median, times.p95, times.p99 };
+	const Color4f percentileColors[]{ { 0.4f, 0.9f, 0.4f, 1.f }, { 1.f, 0.9f, 0.3f, 1.f }, { 0.9f, 0.3f, 0.3f, 1.f } };
+	for (int i = 0; i < 3 && times.nrFrames > 0; i++)
+	{
+		float x{ std::min(percentiles[i], float(g_HistogramBuckets)) * g_BucketWidth };
+		AddOverlayQuad(left + x, histogramBottom, 1.f, g_HistogramHeight, percentileColors[i]);
 	}
-	g_Counter++;
-}
 
-void DrawBlock(float x, float y, int blockType)
-{
-	glBegin(GL_QUADS);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(CellVertex), &g_OverlayVertices[0].x);
+	glColorPointer(3, GL_FLOAT, sizeof(CellVertex), &g_OverlayVertices[0].r);
+	glDrawArrays(GL_QUADS, 0, GLsizei(g_OverlayVertices.size()));
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 
-	BlockTypes bType{ BlockTypes(blockType) };
-	switch (bType)
+	// The numbers above the graph and which color is which zone next to it
+	if (!g_IsHudFontLoaded)
 	{
-	case BlockTypes::Square:
-		glColor3f(0.f, 0.f, 1.f);
-		break;
-	case BlockTypes::Line:
-		glColor3f(1.f, 0.f, 0.f);
-		break;
-	case BlockTypes::zBlock:
-		glColor3f(0.0f, 1.f, 0.f);
-		break;
+		return;
+	}
+	char numbers[96]{};
+	snprintf(numbers, sizeof(numbers), "frame %.1f ms  95%% %.1f ms  99%% %.1f ms  max %.1f ms", times.median, times.p95, times.p99, times.max);
+	AddText(g_SmallText, g_SmallFont, numbers, left, graphBottom + graphHeight - g_SmallFont.lineHeight, white);
+	float nameTop{ graphBottom + graphHeight - 2.f * g_SmallFont.lineHeight };
+	for (int i = 0; i < g_FrameSlots && GetSlotName(i); i++)
+	{
+		AddText(g_SmallText, g_SmallFont, GetSlotName(i), left + g_FrameHistory + 10.f, nameTop - i * g_SmallFont.lineHeight, g_SlotColors[i]);
 	}
-	glVertex2f(x * g_BlockSize + g_Left + g_BlockSize, (y+1) * g_BlockSize); //Bottom left
-	glVertex2f(x * g_BlockSize + g_Left + (2 * g_BlockSize), (y+1) * g_BlockSize);//Bottom Right
-	glVertex2f(x * g_BlockSize + g_Left + (2 * g_BlockSize), (y+1) * g_BlockSize + g_BlockSize);//Top right
-	glVertex2f(x * g_BlockSize + g_Left + g_BlockSize, (y+1) * g_BlockSize + g_BlockSize);//Top left
-	glEnd();
+	DrawTextBatch(g_SmallText, g_SmallFont);
 }
 
-void MoveZ(Block *pMoving, bool stateZ, int bTypes)
+void AddOverlayQuad(float left, float bottom, float width, float height, const Color4f& color)
 {
-	for (int i = 0; i < g_GridSize; i++)
-	{
-		if (g_Index == i)
-		{
-			if (stateZ)
-			{
-				pMoving[i].isMoving = true;
-				pMoving[i + 10].isMoving = true;
-				pMoving[i + 9].isMoving = true;
-				pMoving[i + 19].isMoving = true;
-				pMoving[i].blockType = bTypes;
-				pMoving[i + 10].blockType = bTypes;
-				pMoving[i + 9].blockType = bTypes;
-				pMoving[i + 19].blockType = bTypes;
-			}
-			else
-			{
-				pMoving[i].isMoving = true;
-				pMoving[i + 1].isMoving = true;
-				pMoving[i + 11].isMoving = true;
-				pMoving[i + 12].isMoving = true;
-				pMoving[i].blockType = bTypes;
-				pMoving[i + 1].blockType = bTypes;
-				pMoving[i + 11].blockType = bTypes;
-				pMoving[i + 12].blockType = bTypes;
-			}
-		}
-	}
+	float right{ left + width };
+	float top{ bottom + height };
+	g_OverlayVertices.push_back(CellVertex{ left, bottom, color.r, color.g, color.b });
+	g_OverlayVertices.push_back(CellVertex{ left, top, color.r, color.g, color.b });
+	g_OverlayVertices.push_back(CellVertex{ right, top, color.r, color.g, color.b });
+	g_OverlayVertices.push_back(CellVertex{ right, bottom, color.r, color.g, color.b });
 }
 
-void FillZ(Block *pFilled, bool stateZ, int bTypes)
+void DrawHud()
 {
-	for (int i = 0; i < g_GridSize; i++)
+	PROFILE_ZONE("DrawHud");
+	if (!g_IsHudFontLoaded)
 	{
-		if (g_Index == i)
-		{
-			if (stateZ)
-			{
-				pFilled[i].isFilled = true;
-				pFilled[i + 10].isFilled = true;
-				pFilled[i + 9].isFilled = true;
-				pFilled[i + 19].isFilled = true;
-				pFilled[i].blockType = bTypes;
-				pFilled[i + 10].blockType = bTypes;
-				pFilled[i + 9].blockType = bTypes;
-				pFilled[i + 19].blockType = bTypes;
-			}
-			else
-			{
-				pFilled[i].isFilled = true;
-				pFilled[i + 1].isFilled = true;
-				pFilled[i + 11].isFilled = true;
-				pFilled[i + 12].isFilled = true;
-				pFilled[i].blockType = bTypes;
-				pFilled[i + 1].blockType = bTypes;
-				pFilled[i + 11].blockType = bTypes;
-				pFilled[i + 12].blockType = bTypes;
-			}
-		}
+		return;
 	}
-}
 
-void MoveSquare(Block *pMoving, int bTypes)
-{
-	for (int i = 0; i < g_GridSize; i++)
+	// Every string is formatted on the stack and appended to the batch of its font, one draw call per font
+	const Color4f labelColor{ 0.2f, 0.25f, 0.35f, 1.f };
+	const Color4f valueColor{ 0.05f, 0.05f, 0.1f, 1.f };
+	const char* labels[]{ "Score", "Lines", "Pieces" };
+	const int values[]{ g_State.score, g_State.lines, g_State.blocksUsed };
+	float left{ g_Left + g_LayoutWidth + 30.f };
+	float top{ g_WindowHeight - 60.f };
+	char text[16]{};
+	for (int i = 0; i < 3; i++)
 	{
-		if (g_Index == i)
-		{
-			pMoving[i].isMoving = true; // Bottom left
-			pMoving[i+1].isMoving = true; // Bottom right
-			pMoving[i+10].isMoving = true; // Top left
-			pMoving[i+11].isMoving = true; // Top right
-			pMoving[i].blockType = bTypes;
-			pMoving[i + 1].blockType = bTypes;
-			pMoving[i + 10].blockType = bTypes;
-			pMoving[i + 11].blockType = bTypes;
-		}
+		AddText(g_SmallText, g_SmallFont, labels[i], left, top, labelColor);
+		snprintf(text, sizeof(text), "%d", values[i]);
+		AddText(g_HudText, g_HudFont, text, left, top - g_HudFont.lineHeight, valueColor);
+		top -= g_SmallFont.lineHeight + g_HudFont.lineHeight + 20.f;
+	}
+	if (g_State.isGameOver)
+	{
+		AddText(g_HudText, g_HudFont, "Game over", left, top, valueColor);
+	}
+	else if (g_IsReplaying)
+	{
+		AddText(g_SmallText, g_SmallFont, "Replay", left, top, labelColor);
+	}
+	else if (g_IsAiPlaying)
+	{
+		AddText(g_SmallText, g_SmallFont, "AI playing", left, top, labelColor);
 	}
+	DrawTextBatch(g_HudText, g_HudFont);
+	DrawTextBatch(g_SmallText, g_SmallFont);
 }
 
-void FillSquare(Block *pMoving, int bTypes)
+void DrawGrid()
 {
-	for (int i = 0; i < g_GridSize; i++)
+	PROFILE_ZONE("DrawGrid");
+	SwapLayout();
+	// Nothing to show until the first layout is uploaded, one that failed shows the checkerboard
+	if (GetTextureState(g_Grid) == TextureState::Loading)
 	{
-		if (g_Index == i)
-		{
-			pMoving[i].isFilled = true; // Bottom left
-			pMoving[i + 1].isFilled = true; // Bottom right
-			pMoving[i + 10].isFilled = true; // Top left
-			pMoving[i + 11].isFilled = true; // Top right
-			pMoving[i].blockType = bTypes;
-			pMoving[i + 1].blockType = bTypes;
-			pMoving[i + 10].blockType = bTypes;
-			pMoving[i + 11].blockType = bTypes;
-		}
+		return;
 	}
+	Rectf destRect;
+	destRect.left = g_Left;
+	destRect.width = g_LayoutWidth;
+	destRect.height = g_LayoutHeight;
+	destRect.bottom = 0.0f;
+
+	DrawTexture(GetTexture(g_Grid), destRect);
 }
 
-void MoveLine(bool stateLine, Block *pMoving, int bTypes)
+void SwapLayout()
 {
-	for (int i = 0; i < g_GridSize; i++)
+	TextureState state{ GetTextureState(g_NextGrid) };
+	if (g_NextGrid == g_NoTexture || state == TextureState::Loading)
 	{
-		if (i == g_Index)
-		{
-			if (stateLine)
-			{
-				for (int j = 0; j < 4; j++)
-				{
-					pMoving[i + (j * 10)].isMoving = true;
-					pMoving[i + (j * 10)].blockType = bTypes;
-				}
-
-			}
-			else if (!stateLine)
-			{
-				for (int j = 0; j < 4; j++)
-				{
-					pMoving[i + j].isMoving = true;
-					pMoving[i + j].blockType = bTypes;
-				}
-			}
-		}
-
+		return;
 	}
+	if (state == TextureState::Ready)
+	{
+		ReleaseTexture(g_Grid);
+		g_Grid = g_NextGrid;
+	}
+	else
+	{
+		ReleaseTexture(g_NextGrid);
+	}
+	g_NextGrid = g_NoTexture;
 }
 
-void FillLine(bool stateLine, Block *pMoving, int bTypes)
+void DrawFills(const Board& board)
 {
-	for (int i = 0; i < g_GridSize; i++)
-	{
-		if (i == g_Index)
-		{
-			if (stateLine)
-			{
-				for (int j = 0; j < 4; j++)
-				{
-					pMoving[i + (j * 10)].isFilled = true;
-					pMoving[i + (j * 10)].blockType = bTypes;
-				}
+	PROFILE_ZONE("DrawFills");
+	UpdateFills(g_Cells, board, g_Left, g_BlockSize);
+}
 
-			}
-			else if (!stateLine)
-			{
-				for (int j = 0; j < 4; j++)
-				{
-					pMoving[i + j].isFilled = true;
-					pMoving[i + j].blockType = bTypes;
-				}
-			}
-		}
+void DrawMoving(const GameState& state)
+{
+	PROFILE_ZONE("DrawMoving");
+	UpdateMoving(g_Cells, state, GetFallOffset(state, g_StepTime), g_Left, g_BlockSize);
+}
 
+void DrawCells()
+{
+	PROFILE_ZONE("DrawCells");
+	if (g_Cells.vertices.empty())
+	{
+		return;
 	}
+
+	// All cells go to the driver as one interleaved array in a single draw call
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(CellVertex), &g_Cells.vertices[0].x);
+	glColorPointer(3, GL_FLOAT, sizeof(CellVertex), &g_Cells.vertices[0].r);
+	glDrawArrays(GL_QUADS, 0, GLsizei(g_Cells.vertices.size()));
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 void Draw( )
 {
+	PROFILE_ZONE("Draw");
+	{
+		PROFILE_ZONE("Upload");
+		UploadTextures(g_AssetTimeBudget);
+	}
 	ClearBackground( );
 	DrawGrid();
-	DrawMoving(g_GridArray);
-	DrawFills(g_GridArray);
+	DrawFills(g_State.board);
+	DrawMoving(g_State);
+	DrawCells();
+	DrawHud();
+	if (g_IsShowingProfiler)
+	{
+		DrawProfiler();
+	}
 }
 
 void ClearBackground( )
@@ -755,40 +777,60 @@ void Run( )
 	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
 
 	InitGameResources();
-	GridFill(g_NrCols, g_GridArray);
+	if (g_pProfilePath)
+	{
+		StartProfiler(g_pProfilePath);
+	}
+	if (g_IsReplaying)
+	{
+		StartPlayback(g_Player, ViewReplay(g_Replay));
+		g_State = g_Player.position.state;
+	}
+	else
+	{
+		NewGame(g_State, g_Seed);
+		g_IsRecording = g_pRecordPath != nullptr;
+		if (g_IsRecording)
+		{
+			StartRecording(g_Replay, g_State);
+		}
+	}
 	
 	//The event loop
 	SDL_Event e{};
 	while ( !quit )
 	{
 		// Poll next event from queue
-		while ( SDL_PollEvent( &e ) != 0 )
 		{
-			// Handle the polled event
-			switch ( e.type )
+			PROFILE_ZONE("Poll");
+			while ( SDL_PollEvent( &e ) != 0 )
 			{
-			case SDL_QUIT:
-				//std::cout << "\nSDL_QUIT\n";
-				quit = true;
-				break;
-			case SDL_KEYDOWN:
-				ProcessKeyDownEvent(e.key);
-				break;
-			case SDL_KEYUP:
-				ProcessKeyUpEvent(e.key);
-				break;
-			case SDL_MOUSEMOTION:
-				ProcessMouseMotionEvent(e.motion);
-				break;
-			case SDL_MOUSEBUTTONDOWN:
-				ProcessMouseDownEvent(e.button);
-				break;
-			case SDL_MOUSEBUTTONUP:
-				ProcessMouseUpEvent(e.button);
-				break;
-			default:
-				//std::cout << "\nSome other event\n";
-				break;
+				// Handle the polled event
+				switch ( e.type )
+				{
+				case SDL_QUIT:
+					//std::cout << "\nSDL_QUIT\n";
+					quit = true;
+					break;
+				case SDL_KEYDOWN:
+					ProcessKeyDownEvent(e.key);
+					break;
+				case SDL_KEYUP:
+					ProcessKeyUpEvent(e.key);
+					break;
+				case SDL_MOUSEMOTION:
+					ProcessMouseMotionEvent(e.motion);
+					break;
+				case SDL_MOUSEBUTTONDOWN:
+					ProcessMouseDownEvent(e.button);
+					break;
+				case SDL_MOUSEBUTTONUP:
+					ProcessMouseUpEvent(e.button);
+					break;
+				default:
+					//std::cout << "\nSome other event\n";
+					break;
+				}
 			}
 		}
 
@@ -815,14 +857,104 @@ void Run( )
 			Draw( );
 
 			// Update screen: swap back and front buffer
-			SDL_GL_SwapWindow( g_pWindow );
+			{
+				PROFILE_ZONE("Swap");
+				SDL_GL_SwapWindow( g_pWindow );
+				MeasureLatency();
+			}
+			EndProfileFrame();
 		}
 	}
 	FreeGameResources( );
 }
 
+bool ParseArguments(int argc, char* args[])
+{
+	TraceLevel level{ TraceLevel::Off };
+	TraceFormat format{ TraceFormat::Text };
+	const char* path{ nullptr };
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument{ args[i] };
+		if (argument == "--trace" && i + 1 < argc)
+		{
+			std::string value{ args[++i] };
+			level = value == "boards" ? TraceLevel::Boards : value == "pieces" ? TraceLevel::Pieces : TraceLevel::Off;
+		}
+		else if (argument == "--trace-binary")
+		{
+			format = TraceFormat::Binary;
+		}
+		else if (argument == "--trace-file" && i + 1 < argc)
+		{
+			path = args[++i];
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			// The whole argument has to be a number that fits, strtoull saturates and sets errno when it doesn't
+			const char* pSeed{ args[++i] };
+			char* pEnd{};
+			errno = 0;
+			g_Seed = strtoull(pSeed, &pEnd, 10);
+			if (pEnd == pSeed || *pEnd != '\0' || errno == ERANGE || *pSeed == '-')
+			{
+				std::cout << "Invalid seed " << pSeed << std::endl;
+				return false;
+			}
+		}
+		else if (argument == "--profile" && i + 1 < argc)
+		{
+			g_pProfilePath = args[++i];
+		}
+		else if (argument == "--latency")
+		{
+			g_IsMeasuringLatency = true;
+		}
+		else if (argument == "--record" && i + 1 < argc)
+		{
+			g_pRecordPath = args[++i];
+		}
+		else if (argument == "--replay" && i + 1 < argc)
+		{
+			g_IsReplaying = LoadReplay(g_Replay, args[++i]);
+			if (!g_IsReplaying)
+			{
+				std::cout << "Could not read replay " << args[i] << std::endl;
+			}
+		}
+	}
+
+	if (!StartTrace(level, format, path))
+	{
+		std::cout << "Could not open trace file " << path << std::endl;
+	}
+	return true;
+}
+
+void PrintUsage()
+{
+	std::cout << "usage: tetris [--seed n] [--trace pieces|boards] [--trace-binary] [--trace-file file] [--profile file] [--latency]"
+		" [--record file] [--replay file]" << std::endl;
+}
+
 void Cleanup( )
 {
+	StopTrace( );
+	PrintLatency();
+	if (!StopProfiler())
+	{
+		std::cout << "Could not write profile " << g_pProfilePath << std::endl;
+	}
+	if (g_IsRecording)
+	{
+		g_IsRecording = false;
+		FinishRecording(g_Replay, g_State);
+		if (!SaveReplay(g_Replay, g_pRecordPath))
+		{
+			std::cout << "Could not write replay " << g_pRecordPath << std::endl;
+		}
+	}
+
 	SDL_GL_DeleteContext( g_pContext );
 
 	SDL_DestroyWindow( g_pWindow );
@@ -870,156 +1002,6 @@ void QuitOnTtfError()
 
 #pragma region textureImplementations
 
-bool TextureFromFile(const std::string& path, Texture & texture)
-{
-	//Load file for use as an image in a new surface.
-	SDL_Surface* pLoadedSurface = IMG_Load(path.c_str());
-	if (pLoadedSurface == nullptr)
-	{
-		std::cerr << "TextureFromFile: SDL Error when calling IMG_Load: " << SDL_GetError() << std::endl;
-		return false;
-	}
-
-	TextureFromSurface(pLoadedSurface, texture);
-
-	//Free loaded surface
-	SDL_FreeSurface(pLoadedSurface);
-
-	return true;
-}
-
-bool TextureFromString(const std::string & text, const std::string& fontPath, int ptSize, const Color4f & textColor, Texture & texture)
-{
-	// Create font
-	TTF_Font *pFont{};
-	pFont = TTF_OpenFont(fontPath.c_str(), ptSize);
-	if (pFont == nullptr)
-	{
-		std::cout << "TextureFromString: Failed to load font! SDL_ttf Error: " << TTF_GetError();
-		std::cin.get();
-		return false;
-	}
-
-	// Create texture using this fontand close font afterwards
-	bool textureOk = TextureFromString(text, pFont, textColor, texture);
-	TTF_CloseFont(pFont);
-
-	return textureOk;
-}
-
-bool TextureFromString(const std::string & text, TTF_Font *pFont, const Color4f & color, Texture & texture)
-{
-	//Render text surface
-	SDL_Color textColor{};
-	textColor.r = Uint8(color.r * 255);
-	textColor.g = Uint8(color.g * 255);
-	textColor.b = Uint8(color.b * 255);
-	textColor.a = Uint8(color.a * 255);
-
-	SDL_Surface* pLoadedSurface = TTF_RenderText_Blended(pFont, text.c_str(), textColor);
-	//SDL_Surface* pLoadedSurface = TTF_RenderText_Solid(pFont, textureText.c_str(), textColor);
-	if (pLoadedSurface == nullptr)
-	{
-		std::cerr << "TextureFromString: Unable to render text surface! SDL_ttf Error: " << TTF_GetError() << '\n';
-		return false;
-	}
-
-	// copy to video memory
-	TextureFromSurface(pLoadedSurface, texture);
-
-	//Free loaded surface
-	SDL_FreeSurface(pLoadedSurface);
-
-	return true;
-}
-
-void TextureFromSurface(const SDL_Surface *pSurface, Texture & texture)
-{
-	//Get image dimensions
-	texture.width = float(pSurface->w);
-	texture.height = float(pSurface->h);
-
-	// Get pixel format information and translate to OpenGl format
-	GLenum pixelFormat{ GL_RGB };
-	switch (pSurface->format->BytesPerPixel)
-	{
-	case 3:
-		if (pSurface->format->Rmask == 0x000000ff)
-		{
-			pixelFormat = GL_RGB;
-		}
-		else
-		{
-			pixelFormat = GL_BGR;
-		}
-		break;
-	case 4:
-		if (pSurface->format->Rmask == 0x000000ff)
-		{
-			pixelFormat = GL_RGBA;
-		}
-		else
-		{
-			pixelFormat = GL_BGRA;
-		}
-		break;
-	default:
-		std::cerr << "TextureFromSurface error: Unknow pixel format, BytesPerPixel: " << pSurface->format->BytesPerPixel << "\nUse 32 bit or 24 bit images.\n";;
-		texture.width = 0;
-		texture.height = 0;
-		return;
-	}
-
-	//Generate an array of textures.  We only want one texture (one element array), so trick
-	//it by treating "texture" as array of length one.
-	glGenTextures(1, &texture.id);
-
-	//Select (bind) the texture we just generated as the current 2D texture OpenGL is using/modifying.
-	//All subsequent changes to OpenGL's texturing state for 2D textures will affect this texture.
-	glBindTexture(GL_TEXTURE_2D, texture.id);
-
-	// check for errors.
-	GLenum e = glGetError();
-	if (e != GL_NO_ERROR)
-	{
-		std::cerr << "TextureFromSurface, error binding textures, Error id = " << e << '\n';
-		texture.width = 0;
-		texture.height = 0;
-		return;
-	}
-
-	//Specify the texture's data.  This function is a bit tricky, and it's hard to find helpful documentation.  A summary:
-	//   GL_TEXTURE_2D:    The currently bound 2D texture (i.e. the one we just made)
-	//               0:    The mipmap level.  0, since we want to update the base level mipmap image (i.e., the image itself,
-	//                         not cached smaller copies)
-	//         GL_RGBA:    Specifies the number of color components in the texture.
-	//                     This is how OpenGL will store the texture internally (kinda)--
-	//                     It's essentially the texture's type.
-	//      surface->w:    The width of the texture
-	//      surface->h:    The height of the texture
-	//               0:    The border.  Don't worry about this if you're just starting.
-	//     pixelFormat:    The format that the *data* is in--NOT the texture! 
-	//GL_UNSIGNED_BYTE:    The type the data is in.  In SDL, the data is stored as an array of bytes, with each channel
-	//                         getting one byte.  This is fairly typical--it means that the image can store, for each channel,
-	//                         any value that fits in one byte (so 0 through 255).  These values are to be interpreted as
-	//                         *unsigned* values (since 0x00 should be dark and 0xFF should be bright).
-	// surface->pixels:    The actual data.  As above, SDL's array of bytes.
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pSurface->w, pSurface->h, 0, pixelFormat, GL_UNSIGNED_BYTE, pSurface->pixels);
-
-	//Set the minification and magnification filters.  In this case, when the texture is minified (i.e., the texture's pixels (texels) are
-	//*smaller* than the screen pixels you're seeing them on, linearly filter them (i.e. blend them together).  This blends four texels for
-	//each sample--which is not very much.  Mipmapping can give better results.  Find a texturing tutorial that discusses these issues
-	//further.  Conversely, when the texture is magnified (i.e., the texture's texels are *larger* than the screen pixels you're seeing
-	//them on), linearly filter them.  Qualitatively, this causes "blown up" (overmagnified) textures to look blurry instead of blocky.
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-}
-
-void DeleteTexture(Texture & texture)
-{
-	glDeleteTextures(1, &texture.id);
-}
-
 void DrawTexture(const Texture & texture, const Point2f& bottomLeftVertex, const Rectf & sourceRect)
 {
 	Rectf destinationRect{ bottomLeftVertex.x, bottomLeftVertex.y, sourceRect.width, sourceRect.height };
@@ -1063,23 +1045,17 @@ void DrawTexture(const Texture & texture, const Rectf & destinationRect, const R
 	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 
 	// Draw
+	const GLfloat texCoords[]{ textLeft, textBottom, textLeft, textTop, textRight, textTop, textRight, textBottom };
+	const GLfloat vertices[]{ vertexLeft, vertexBottom, vertexLeft, vertexTop, vertexRight, vertexTop, vertexRight, vertexBottom };
 	glEnable(GL_TEXTURE_2D);
 	{
-		glBegin(GL_QUADS);
-		{
-			glTexCoord2f(textLeft, textBottom);
-			glVertex2f(vertexLeft, vertexBottom);
-
-			glTexCoord2f(textLeft, textTop);
-			glVertex2f(vertexLeft, vertexTop);
-
-			glTexCoord2f(textRight, textTop);
-			glVertex2f(vertexRight, vertexTop);
-
-			glTexCoord2f(textRight, textBottom);
-			glVertex2f(vertexRight, vertexBottom);
-		}
-		glEnd();
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glVertexPointer(2, GL_FLOAT, 0, vertices);
+		glTexCoordPointer(2, GL_FLOAT, 0, texCoords);
+		glDrawArrays(GL_QUADS, 0, 4);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
 	}
 	glDisable(GL_TEXTURE_2D);
 
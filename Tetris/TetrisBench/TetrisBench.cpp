@@ -0,0 +1,388 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+
+#include "GameState.h"
+#include "Policy.h"
+#include "MoveGen.h"
+#include "BeamSearch.h"
+#include "CellBatch.h"
+#include "TetrisEnv.h"
+
+// Microbenchmarks of the hot paths of one game step and one frame.
+// Run tetris_bench --benchmark_filter=<name> to time a single one.
+
+// A board with rows of scattered cells up to the given height, none of them full
+template<int Width, int Rows>
+void FillRandomRows(BasicBoard<Width, Rows>& board, int height, uint64_t seed)
+{
+	using Bits = typename BasicBoard<Width, Rows>::Bits;
+	const Bits fullRow{ BasicBoard<Width, Rows>::fullRow };
+	Random random{};
+	SeedRandom(random, seed);
+	for (int i = 0; i < height; i++)
+	{
+		Bits row{ Bits(NextRandom(random) & fullRow) };
+		if (row == fullRow)
+		{
+			row &= Bits(~1u);
+		}
+		board.filled[i] = row;
+		for (int j = 0; j < Width; j++)
+		{
+			SetColor(board, j, i, int(RandomBelow(random, g_NrBlockTypes)));
+		}
+	}
+	board.height = height;
+	board.revision++;
+	board.hash = HashRows<Width, Rows>(board.filled, 0, height);
+}
+
+void BM_Spawn(benchmark::State& state)
+{
+	GameState game{};
+	NewGame(game, 1);
+	for (auto _ : state)
+	{
+		// With a full gravity unit and no moving piece the next step spawns one
+		game.isMoving = false;
+		game.gravityProgress = g_GravityUnit;
+		Step(game, InputNone);
+		benchmark::DoNotOptimize(game.figure);
+	}
+}
+BENCHMARK(BM_Spawn);
+
+void BM_GravityStep(benchmark::State& state)
+{
+	GameState game{};
+	NewGame(game, 1);
+	Step(game, InputNone);
+	int spawnY{ game.y };
+	for (auto _ : state)
+	{
+		game.y = spawnY;
+		game.gravityProgress = g_GravityUnit;
+		Step(game, InputNone);
+		benchmark::DoNotOptimize(game.y);
+	}
+}
+BENCHMARK(BM_GravityStep);
+
+void BM_Lock(benchmark::State& state)
+{
+	Board base{};
+	FillRandomRows(base, 8, 2);
+	const PieceMask& piece{ GetPieceMask(int(BlockTypes::tBlock), 0) };
+	for (auto _ : state)
+	{
+		Board board{ base };
+		LockPiece(board, piece, g_SpawnX, 9, int(BlockTypes::tBlock));
+		benchmark::DoNotOptimize(board);
+	}
+}
+BENCHMARK(BM_Lock);
+
+template<class BoardType>
+void BM_LineClear(benchmark::State& state)
+{
+	// The argument is the number of full rows at the bottom, with scattered rows above them
+	int nrFull{ int(state.range(0)) };
+	BoardType base{};
+	FillRandomRows(base, 12, 3);
+	for (int i = 0; i < nrFull; i++)
+	{
+		base.filled[i] = BoardType::fullRow;
+	}
+	for (auto _ : state)
+	{
+		BoardType board{ base };
+		benchmark::DoNotOptimize(ClearFullRows(board, 0, 4));
+		benchmark::DoNotOptimize(board);
+	}
+}
+BENCHMARK_TEMPLATE(BM_LineClear, Board)->DenseRange(0, 4);
+// The research boards, each with its own row storage
+BENCHMARK_TEMPLATE(BM_LineClear, Board8x20)->Arg(0)->Arg(4);
+BENCHMARK_TEMPLATE(BM_LineClear, Board10x20)->Arg(0)->Arg(4);
+BENCHMARK_TEMPLATE(BM_LineClear, Board16x20)->Arg(0)->Arg(4);
+BENCHMARK_TEMPLATE(BM_LineClear, Board32x20)->Arg(0)->Arg(4);
+
+void BM_FrameBuild(benchmark::State& state)
+{
+	// Argument 1 changes the board every frame so the filled cells are rebuilt, 0 reuses them
+	bool isBoardChanging{ state.range(0) != 0 };
+	GameState game{};
+	NewGame(game, 4);
+	FillRandomRows(game.board, 10, 4);
+	Step(game, InputNone);
+	CellBatch batch{};
+	for (auto _ : state)
+	{
+		if (isBoardChanging)
+		{
+			game.board.revision++;
+		}
+		UpdateFills(batch, game.board, 400.f, 40.f);
+		UpdateMoving(batch, game, GetFallOffset(game, 0.5f), 400.f, 40.f);
+		benchmark::DoNotOptimize(batch.vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(batch.vertices.size() / 4));
+}
+BENCHMARK(BM_FrameBuild)->Arg(0)->Arg(1);
+
+void BM_GeneratePlacements(benchmark::State& state)
+{
+	// Every block type from its spawn position on a board with a ragged stack of the given height
+	Board board{};
+	FillRandomRows(board, int(state.range(0)), 5);
+	PlacementList list{};
+	int blockType{};
+	for (auto _ : state)
+	{
+		GeneratePlacements(board, blockType, g_SpawnX, g_PieceTables.spawnY[blockType], 0, list);
+		benchmark::DoNotOptimize(list.count);
+		blockType = (blockType + 1) % g_NrBlockTypes;
+	}
+}
+BENCHMARK(BM_GeneratePlacements)->Arg(4)->Arg(10);
+
+void BM_GreedyGame(benchmark::State& state)
+{
+	// Whole games of at most 100 pieces, the rate is pieces per second
+	uint64_t seed{};
+	int64_t nrPieces{};
+	GameState game{};
+	Policy policy{};
+	for (auto _ : state)
+	{
+		NewGame(game, seed);
+		ResetPolicy(policy, PolicyType::Greedy, seed);
+		PlayGame(game, policy, 100);
+		nrPieces += game.blocksUsed;
+		seed++;
+	}
+	state.SetItemsProcessed(nrPieces);
+}
+BENCHMARK(BM_GreedyGame);
+
+void BM_ReplayPlayback(benchmark::State& state)
+{
+	// Plays back a recorded greedy game of 500 pieces from the start, the rate is steps per second
+	GameState game{};
+	Policy policy{};
+	Replay replay{};
+	NewGame(game, 3);
+	ResetPolicy(policy, PolicyType::Greedy, 3);
+	PlayGame(game, policy, 500, &replay);
+	ReplayPlayer player{};
+	for (auto _ : state)
+	{
+		StartPlayback(player, ViewReplay(replay));
+		PlayReplay(player, replay.header.endStep);
+		benchmark::DoNotOptimize(player.position.state.board.hash);
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * replay.header.endStep);
+	state.counters["bytes/piece"] = double(replay.header.nrBytes) / game.blocksUsed;
+}
+BENCHMARK(BM_ReplayPlayback);
+
+void BM_BoardFeatures(benchmark::State& state)
+{
+	Board board{};
+	FillRandomRows(board, 12, 6);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(GetBoardFeatures(board.filled, board.height));
+	}
+}
+BENCHMARK(BM_BoardFeatures);
+
+// Every kernel against the scalar one on random boards of every height, the row counts of the calls run from 0 to
+// all the rows so the masking of the unused ones is checked too
+bool MatchesScalarKernels(const BoardKernels& kernels)
+{
+	const BoardKernels& scalar{ *GetBoardKernels(KernelLevel::Scalar) };
+	alignas(32) int16_t heights[2][g_PaddedWidth];
+	alignas(32) int16_t counts[2][g_PaddedWidth];
+	alignas(32) int16_t depths[2][g_PaddedWidth];
+	for (uint64_t seed = 1; seed <= 64; seed++)
+	{
+		for (int height = 0; height <= g_BoardRows; height++)
+		{
+			Board board{};
+			FillRandomRows(board, height, seed);
+			for (int nrRows = 0; nrRows <= g_BoardRows; nrRows++)
+			{
+				const uint16_t* pRows{ board.filled };
+				scalar.columnHeights(pRows, nrRows, heights[0], counts[0]);
+				kernels.columnHeights(pRows, nrRows, heights[1], counts[1]);
+				if (memcmp(heights[0], heights[1], sizeof(heights[0])) != 0 || memcmp(counts[0], counts[1], sizeof(counts[0])) != 0
+					|| scalar.holes(pRows, nrRows) != kernels.holes(pRows, nrRows)
+					|| scalar.rowTransitions(pRows, nrRows) != kernels.rowTransitions(pRows, nrRows)
+					|| scalar.columnTransitions(pRows, nrRows) != kernels.columnTransitions(pRows, nrRows)
+					|| scalar.wellDepths(heights[0], depths[0]) != kernels.wellDepths(heights[0], depths[1])
+					|| memcmp(depths[0], depths[1], sizeof(depths[0])) != 0)
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// The board kernels of the level in the argument, 0 scalar, 1 SSE2 and 2 AVX2, on a board 12 rows high.
+// Kernels that don't match the scalar ones aren't timed.
+const BoardKernels* GetBenchKernels(benchmark::State& state, Board& board)
+{
+	FillRandomRows(board, 12, 6);
+	const BoardKernels* pKernels{ GetBoardKernels(KernelLevel(state.range(0))) };
+	if (pKernels == nullptr)
+	{
+		state.SkipWithError("not supported on this CPU");
+		return nullptr;
+	}
+	if (!MatchesScalarKernels(*pKernels))
+	{
+		state.SkipWithError("doesn't match the scalar kernels");
+		return nullptr;
+	}
+	state.SetLabel(pKernels->pName);
+	return pKernels;
+}
+
+void BM_ColumnHeights(benchmark::State& state)
+{
+	Board board{};
+	const BoardKernels* pKernels{ GetBenchKernels(state, board) };
+	alignas(32) int16_t heights[g_PaddedWidth];
+	alignas(32) int16_t counts[g_PaddedWidth];
+	for (auto _ : state)
+	{
+		pKernels->columnHeights(board.filled, board.height, heights, counts);
+		benchmark::DoNotOptimize(heights);
+		benchmark::DoNotOptimize(counts);
+	}
+}
+BENCHMARK(BM_ColumnHeights)->DenseRange(0, 2);
+
+void BM_Holes(benchmark::State& state)
+{
+	Board board{};
+	const BoardKernels* pKernels{ GetBenchKernels(state, board) };
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(pKernels->holes(board.filled, board.height));
+	}
+}
+BENCHMARK(BM_Holes)->DenseRange(0, 2);
+
+void BM_Transitions(benchmark::State& state)
+{
+	Board board{};
+	const BoardKernels* pKernels{ GetBenchKernels(state, board) };
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(pKernels->rowTransitions(board.filled, board.height));
+		benchmark::DoNotOptimize(pKernels->columnTransitions(board.filled, board.height));
+	}
+}
+BENCHMARK(BM_Transitions)->DenseRange(0, 2);
+
+void BM_WellDepths(benchmark::State& state)
+{
+	Board board{};
+	const BoardKernels* pKernels{ GetBenchKernels(state, board) };
+	alignas(32) int16_t heights[g_PaddedWidth];
+	alignas(32) int16_t counts[g_PaddedWidth];
+	alignas(32) int16_t depths[g_PaddedWidth];
+	if (pKernels != nullptr)
+	{
+		pKernels->columnHeights(board.filled, board.height, heights, counts);
+	}
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(pKernels->wellDepths(heights, depths));
+	}
+}
+BENCHMARK(BM_WellDepths)->DenseRange(0, 2);
+
+void BM_BeamSearch(benchmark::State& state)
+{
+	// One move of the default search with the given number of threads, from positions of a greedy game.
+	// There is no evaluation cache, it would have every board of the same move after the first time.
+	GameState game{};
+	NewGame(game, 7);
+	Policy greedy{};
+	ResetPolicy(greedy, PolicyType::Greedy, 7);
+	PlayGame(game, greedy, 20);
+	SkipSteps(game, StepsUntilDrop(game));
+	Step(game, InputNone);
+	BeamSearch search{};
+	SearchSettings settings{ g_DefaultSearch };
+	settings.nrThreads = int(state.range(0));
+	settings.tableMegabytes = 0;
+	InitBeamSearch(search, settings);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(FindBestPlacement(search, game));
+	}
+}
+BENCHMARK(BM_BeamSearch)->Arg(1)->Arg(4)->UseRealTime();
+
+void BM_BeamGame(benchmark::State& state)
+{
+	// Games of 50 pieces with an evaluation cache of the given size in MB, the rate is pieces per second
+	SearchSettings settings{ g_DefaultSearch };
+	settings.tableMegabytes = int(state.range(0));
+	BeamSearch search{};
+	InitBeamSearch(search, settings);
+	Policy policy{};
+	policy.pSearch = &search;
+	GameState game{};
+	uint64_t seed{};
+	int64_t nrPieces{};
+	for (auto _ : state)
+	{
+		NewGame(game, seed);
+		ResetPolicy(policy, PolicyType::Beam, seed);
+		PlayGame(game, policy, 50);
+		nrPieces += game.blocksUsed;
+		seed++;
+	}
+	state.SetItemsProcessed(nrPieces);
+	const TableStats& stats{ search.tableStats };
+	state.counters["hits"] = stats.probes > 0 ? double(stats.hits) / stats.probes : 0.0;
+	state.counters["collisions"] = stats.probes > 0 ? double(stats.collisions) / stats.probes : 0.0;
+}
+BENCHMARK(BM_BeamGame)->Arg(0)->Arg(16);
+
+void BM_EnvStep(benchmark::State& state)
+{
+	// A batch of 4096 environments with random actions on the given number of threads, the rate is environment steps
+	const int nrEnvs{ 4096 };
+	TetrisEnv* pEnv{ TetrisEnvCreate(int(state.range(0))) };
+	std::vector<uint64_t> seeds(nrEnvs);
+	std::vector<uint8_t> actions(nrEnvs);
+	std::vector<uint8_t> observations(size_t(nrEnvs) * TETRIS_ENV_OBSERVATION_SIZE);
+	std::vector<float> rewards(nrEnvs);
+	std::vector<uint8_t> dones(nrEnvs);
+	Random random{};
+	SeedRandom(random, 7);
+	for (int i = 0; i < nrEnvs; i++)
+	{
+		seeds[i] = uint64_t(i);
+		actions[i] = uint8_t(NextRandom(random) & 31);
+	}
+	TetrisEnvReset(pEnv, nrEnvs, seeds.data(), observations.data());
+	for (auto _ : state)
+	{
+		TetrisEnvStep(pEnv, actions.data(), observations.data(), rewards.data(), dones.data());
+		benchmark::DoNotOptimize(observations.data());
+	}
+	state.SetItemsProcessed(state.iterations() * nrEnvs);
+	TetrisEnvDestroy(pEnv);
+}
+BENCHMARK(BM_EnvStep)->Arg(1)->Arg(4)->UseRealTime();
+
+BENCHMARK_MAIN();
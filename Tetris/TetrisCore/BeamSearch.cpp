@@ -0,0 +1,303 @@
+#include "BeamSearch.h"
+#include <algorithm>
+
+using SearchClock = std::chrono::steady_clock;
+
+void RunSearchWorker(SearchWorkers& workers, int index);
+bool SearchPly(BeamSearch& search, const GameState& state, int ply, SearchClock::time_point deadline);
+void ExpandNodes(SearchWorkers& workers, SearchArena& arena);
+uint64_t HashPlacement(uint64_t hash, const PieceMask& piece, const Placement& placement);
+void AddCandidate(BeamSearch& search, SearchArena& arena, const Board& board, int blockType, const Placement& placement, float lineScore, int parent);
+void KeepBest(std::vector<SearchCandidate>& candidates, int width);
+void PlaceOnBoard(Board& board, int blockType, const SearchCandidate& candidate);
+
+SearchWorkers::~SearchWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		isStopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void InitBeamSearch(BeamSearch& search, const SearchSettings& settings)
+{
+	// The old workers are joined first, they may still be asleep on the old search
+	search.pWorkers.reset();
+	search.settings = settings;
+	search.settings.nrThreads = settings.nrThreads < 1 ? 1 : settings.nrThreads;
+	search.arenas.clear();
+	search.arenas.resize(search.settings.nrThreads);
+	InitTable(search.table, search.settings.tableMegabytes);
+	search.tableStats = TableStats{};
+
+	int width{ search.settings.beamWidth };
+	search.beam.reserve(width);
+	search.next.reserve(width);
+	search.candidates.reserve(width * 64);
+	for (SearchArena& arena : search.arenas)
+	{
+		arena.candidates.reserve(width * 64);
+	}
+
+	search.pWorkers = std::make_unique<SearchWorkers>();
+	SearchWorkers& workers{ *search.pWorkers };
+	workers.generation = 0;
+	workers.nrBusy = 0;
+	workers.isStopping = false;
+	workers.nextNode.store(0);
+	workers.isOutOfTime.store(false);
+	for (int i = 1; i < search.settings.nrThreads; i++)
+	{
+		workers.threads.emplace_back(RunSearchWorker, std::ref(workers), i);
+	}
+}
+
+Placement FindBestPlacement(BeamSearch& search, const GameState& state)
+{
+	Placement current{ state.x, state.y, state.rotation };
+	if (!state.isMoving)
+	{
+		return current;
+	}
+	GeneratePlacements(state, search.firstMoves);
+	if (search.firstMoves.count == 0)
+	{
+		return current;
+	}
+
+	SearchClock::time_point deadline{ SearchClock::time_point::max() };
+	if (search.settings.timeBudget > 0.f)
+	{
+		deadline = SearchClock::now() + std::chrono::duration_cast<SearchClock::duration>(std::chrono::duration<float>(search.settings.timeBudget));
+	}
+
+	// The first ply always finishes, so there is a move however short the budget is
+	SearchPly(search, state, 0, deadline);
+	int depth{ search.settings.depth < g_QueueLength + 1 ? search.settings.depth : g_QueueLength + 1 };
+	int bestMove{ search.beam[0].firstMove };
+	for (int ply = 1; ply < depth; ply++)
+	{
+		// A ply cut short by the deadline isn't used, and every board of the beam topping out ends the search
+		if (!SearchPly(search, state, ply, deadline))
+		{
+			break;
+		}
+		bestMove = search.beam[0].firstMove;
+	}
+
+	for (SearchArena& arena : search.arenas)
+	{
+		AddTableStats(search.tableStats, arena.tableStats);
+		arena.tableStats = TableStats{};
+	}
+	return search.firstMoves.placements[bestMove];
+}
+
+void RunSearchWorker(SearchWorkers& workers, int index)
+{
+	uint64_t seen{};
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock{ workers.mutex };
+			workers.wake.wait(lock, [&] { return workers.isStopping || workers.generation != seen; });
+			if (workers.isStopping)
+			{
+				return;
+			}
+			seen = workers.generation;
+		}
+		ExpandNodes(workers, workers.pSearch->arenas[index]);
+		std::lock_guard<std::mutex> lock{ workers.mutex };
+		if (--workers.nrBusy == 0)
+		{
+			workers.done.notify_one();
+		}
+	}
+}
+
+bool SearchPly(BeamSearch& search, const GameState& state, int ply, SearchClock::time_point deadline)
+{
+	// Every thread expands boards of the beam into its own arena
+	SearchWorkers& workers{ *search.pWorkers };
+	for (SearchArena& arena : search.arenas)
+	{
+		arena.candidates.clear();
+	}
+	workers.pSearch = &search;
+	workers.pState = &state;
+	workers.ply = ply;
+	workers.deadline = deadline;
+	workers.nextNode.store(0, std::memory_order_relaxed);
+	workers.isOutOfTime.store(false, std::memory_order_relaxed);
+	if (!workers.threads.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock{ workers.mutex };
+			workers.generation++;
+			workers.nrBusy = int(workers.threads.size());
+		}
+		workers.wake.notify_all();
+	}
+	ExpandNodes(workers, search.arenas[0]);
+	if (!workers.threads.empty())
+	{
+		std::unique_lock<std::mutex> lock{ workers.mutex };
+		workers.done.wait(lock, [&] { return workers.nrBusy == 0; });
+	}
+	if (workers.isOutOfTime.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	// The arenas are merged in any order, KeepBest orders them completely
+	search.candidates.clear();
+	for (const SearchArena& arena : search.arenas)
+	{
+		search.candidates.insert(search.candidates.end(), arena.candidates.begin(), arena.candidates.end());
+	}
+	if (search.candidates.empty())
+	{
+		return false;
+	}
+	KeepBest(search.candidates, search.settings.beamWidth);
+
+	// The first ply's parent is the placement of the moving piece itself
+	int blockType{ ply == 0 ? state.figure : state.queue[ply - 1] };
+	search.next.clear();
+	for (const SearchCandidate& candidate : search.candidates)
+	{
+		if (ply == 0)
+		{
+			search.next.push_back(SearchNode{ state.board, candidate.lineScore, candidate.parent });
+		}
+		else
+		{
+			const SearchNode& parent{ search.beam[candidate.parent] };
+			search.next.push_back(SearchNode{ parent.board, candidate.lineScore, parent.firstMove });
+		}
+		PlaceOnBoard(search.next.back().board, blockType, candidate);
+	}
+	search.beam.swap(search.next);
+	return true;
+}
+
+void ExpandNodes(SearchWorkers& workers, SearchArena& arena)
+{
+	BeamSearch& search{ *workers.pSearch };
+	const GameState& state{ *workers.pState };
+	int ply{ workers.ply };
+	int nrNodes{ ply == 0 ? search.firstMoves.count : int(search.beam.size()) };
+	int blockType{ ply == 0 ? state.figure : state.queue[ply - 1] };
+	while (true)
+	{
+		int i{ workers.nextNode.fetch_add(1, std::memory_order_relaxed) };
+		if (i >= nrNodes || workers.isOutOfTime.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+		if (ply == 0)
+		{
+			AddCandidate(search, arena, state.board, blockType, search.firstMoves.placements[i], 0.f, i);
+			continue;
+		}
+		if (SearchClock::now() > workers.deadline)
+		{
+			workers.isOutOfTime.store(true, std::memory_order_relaxed);
+			return;
+		}
+		const SearchNode& node{ search.beam[i] };
+		GeneratePlacements(node.board, blockType, g_SpawnX, g_PieceTables.spawnY[blockType], 0, arena.placements);
+		for (int j = 0; j < arena.placements.count; j++)
+		{
+			AddCandidate(search, arena, node.board, blockType, arena.placements.placements[j], node.lineScore, i);
+		}
+	}
+}
+
+uint64_t HashPlacement(uint64_t hash, const PieceMask& piece, const Placement& placement)
+{
+	int col{ placement.x + piece.left };
+	int row{ placement.y + piece.bottom };
+	for (int i = 0; i < piece.height; i++)
+	{
+		hash ^= HashRow(row + i, uint16_t(piece.rows[i] << col));
+	}
+	return hash;
+}
+
+void AddCandidate(BeamSearch& search, SearchArena& arena, const Board& board, int blockType, const Placement& placement, float lineScore, int parent)
+{
+	const PieceMask& piece{ GetPieceMask(blockType, placement.rotation) };
+	LockedRows locked;
+	LockIntoRows(board.filled, board.height, piece, placement.x, placement.y, locked);
+
+	// Without cleared rows only the piece's cells are new, otherwise the rows that are left get hashed again
+	uint64_t hash{ locked.nrCleared == 0 ? HashPlacement(board.hash, piece, placement) : HashRows(locked.rows, 0, locked.nrRows) };
+
+	const EvalWeights& weights{ search.settings.weights };
+	float boardScore{};
+	if (!ProbeTable(search.table, hash, boardScore, arena.tableStats))
+	{
+		boardScore = EvaluateBoard(GetBoardFeatures(locked.rows, locked.nrRows), weights);
+		StoreTable(search.table, hash, boardScore, arena.tableStats);
+	}
+	float lines{ lineScore + weights.lines * locked.nrCleared };
+	arena.candidates.push_back(SearchCandidate{ boardScore + lines, lines, parent, placement, hash });
+}
+
+void KeepBest(std::vector<SearchCandidate>& candidates, int width)
+{
+	// Best first, so the front of the beam is always the best board of the ply. Twice the width is sorted
+	// so there are boards left to fill in for the duplicates that are dropped. Equal scores are ordered by
+	// parent and placement, which are never the same twice, so the order doesn't depend on which thread found what.
+	int nrSorted{ int(candidates.size()) < 2 * width ? int(candidates.size()) : 2 * width };
+	std::partial_sort(candidates.begin(), candidates.begin() + nrSorted, candidates.end(),
+		[](const SearchCandidate& a, const SearchCandidate& b)
+		{
+			if (a.score != b.score)
+			{
+				return a.score > b.score;
+			}
+			if (a.parent != b.parent)
+			{
+				return a.parent < b.parent;
+			}
+			const Placement& p{ a.placement };
+			const Placement& q{ b.placement };
+			return p.rotation != q.rotation ? p.rotation < q.rotation : p.x != q.x ? p.x < q.x : p.y < q.y;
+		});
+
+	int nrKept{};
+	for (int i = 0; i < nrSorted && nrKept < width; i++)
+	{
+		bool isDuplicate{ false };
+		for (int j = 0; j < nrKept && !isDuplicate; j++)
+		{
+			isDuplicate = candidates[j].hash == candidates[i].hash;
+		}
+		if (!isDuplicate)
+		{
+			candidates[nrKept++] = candidates[i];
+		}
+	}
+	candidates.resize(nrKept);
+}
+
+void PlaceOnBoard(Board& board, int blockType, const SearchCandidate& candidate)
+{
+	const Placement& placement{ candidate.placement };
+	LockedRows locked;
+	LockIntoRows(board.filled, board.height, GetPieceMask(blockType, placement.rotation), placement.x, placement.y, locked);
+	for (int i = 0; i < g_BoardRows; i++)
+	{
+		board.filled[i] = i < locked.nrRows ? locked.rows[i] : 0;
+	}
+	board.height = locked.nrRows;
+	board.hash = candidate.hash;
+}
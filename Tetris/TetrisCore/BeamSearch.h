@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "MoveGen.h"
+#include "Evaluate.h"
+#include "TranspositionTable.h"
+
+// Multi-ply beam search for the computer player. Every placement of the moving piece is tried, then every
+// placement of the next pieces from the queue on the best boards so far, keeping beamWidth boards per ply.
+// There is one beam per ply: the threads take its boards one at a time and put what they find in their own arena,
+// then the searching thread merges the arenas and keeps the best. Ties are broken by the placements themselves,
+// so the move found doesn't depend on the number of threads.
+// Different orders of placements often build the same board: the beam keeps each board once, and the
+// evaluations are cached by board hash in a table shared by the threads and kept from move to move.
+struct SearchSettings
+{
+	int beamWidth;
+	int depth; // pieces placed: the moving one and depth - 1 from the queue
+	int nrThreads;
+	float timeBudget; // seconds per move, the deepest finished ply is used when it runs out. 0 has no limit.
+	int tableMegabytes; // size of the evaluation cache, 0 for none. A miss costs more than the SIMD features, so it's off by default.
+	EvalWeights weights;
+};
+
+const SearchSettings g_DefaultSearch{ 48, 3, 1, 0.f, 0, g_DefaultWeights };
+
+struct SearchNode
+{
+	Board board; // only the filled rows and height are kept up to date, the colors don't matter here
+	float lineScore; // weighted lines cleared on the way to this board
+	int firstMove; // which placement of the moving piece the board came from
+};
+
+struct SearchCandidate
+{
+	float score;
+	float lineScore;
+	int parent;
+	Placement placement;
+	uint64_t hash; // of the board after the placement
+};
+
+// Memory of one search thread, kept between moves so searching doesn't allocate once it warmed up
+struct SearchArena
+{
+	std::vector<SearchCandidate> candidates;
+	PlacementList placements;
+	TableStats tableStats;
+};
+
+struct BeamSearch;
+
+// Threads started once by InitBeamSearch that help with every ply. They sleep until the searching thread hands
+// out a ply, then take its boards from nextNode until there are none left. Stopped and joined when the search goes.
+struct SearchWorkers
+{
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	uint64_t generation; // of the ply handed out, under the mutex
+	int nrBusy; // workers still on the ply, under the mutex
+	bool isStopping;
+
+	// The ply being searched, set before the generation changes
+	BeamSearch* pSearch;
+	const GameState* pState;
+	int ply;
+	std::chrono::steady_clock::time_point deadline;
+	std::atomic<int> nextNode;
+	std::atomic<bool> isOutOfTime;
+
+	~SearchWorkers();
+};
+
+struct BeamSearch
+{
+	SearchSettings settings;
+	std::vector<SearchArena> arenas; // one per thread, the searching thread uses the first
+	std::vector<SearchNode> beam;
+	std::vector<SearchNode> next;
+	std::vector<SearchCandidate> candidates; // of all arenas
+	PlacementList firstMoves;
+	TranspositionTable table;
+	TableStats tableStats; // of every search since InitBeamSearch
+	std::unique_ptr<SearchWorkers> pWorkers;
+};
+
+void InitBeamSearch(BeamSearch& search, const SearchSettings& settings);
+// Where the moving piece should go, or where it is when it can't go anywhere
+Placement FindBestPlacement(BeamSearch& search, const GameState& state);
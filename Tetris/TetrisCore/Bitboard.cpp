@@ -0,0 +1,144 @@
+#include "Bitboard.h"
+#include <cstring>
+
+template<int Width, int Rows>
+void ClearBoard(BasicBoard<Width, Rows>& board)
+{
+	for (int i = 0; i < Rows; i++)
+	{
+		board.filled[i] = 0;
+	}
+	for (uint64_t& colors : board.colors)
+	{
+		colors = 0;
+	}
+	board.height = 0;
+	board.revision++;
+	board.hash = 0;
+}
+
+template<int Width, int Rows>
+void LockPiece(BasicBoard<Width, Rows>& board, const PieceMask& piece, int x, int y, int blockType)
+{
+	using Bits = typename BasicBoard<Width, Rows>::Bits;
+	int col{ x + piece.left };
+	int row{ y + piece.bottom };
+	for (int i = 0; i < piece.height; i++)
+	{
+		Bits bits{ Bits(Bits(piece.rows[i]) << col) };
+		board.filled[row + i] |= bits;
+		board.hash ^= HashRow<Width, Rows>(row + i, bits);
+	}
+
+	// Only the color nibbles of the four cells themselves are written
+	for (const PieceCell& cell : piece.cells)
+	{
+		SetColor(board, x + cell.x, y + cell.y, blockType);
+	}
+
+	if (row + piece.height > board.height)
+	{
+		board.height = row + piece.height;
+	}
+	board.revision++;
+}
+
+template<int Width, int Rows>
+int ClearFullRows(BasicBoard<Width, Rows>& board, int firstRow, int nrRows)
+{
+	const int colorWords{ BasicBoard<Width, Rows>::colorWords };
+	// Only the rows a piece was just locked in can have become full
+	int lastRow{ firstRow + nrRows };
+	int write{ firstRow };
+	while (write < lastRow && !IsRowFull(board, write))
+	{
+		write++;
+	}
+	if (write == lastRow)
+	{
+		return 0;
+	}
+	// Every row from the first full one up changes, their keys are taken out now and the new ones put in at the end
+	int firstFull{ write };
+	board.hash ^= HashRows<Width, Rows>(board.filled, firstFull, board.height);
+
+	for (int i = write + 1; i < lastRow; i++)
+	{
+		if (!IsRowFull(board, i))
+		{
+			board.filled[write] = board.filled[i];
+			std::memcpy(&board.colors[write * colorWords], &board.colors[i * colorWords], colorWords * sizeof(board.colors[0]));
+			write++;
+		}
+	}
+	int nrRemoved{ lastRow - write };
+
+	// Everything above the piece drops down in one block, up to the top of the stack
+	int nrAbove{ board.height - lastRow };
+	if (nrAbove > 0)
+	{
+		std::memmove(&board.filled[write], &board.filled[lastRow], nrAbove * sizeof(board.filled[0]));
+		std::memmove(&board.colors[write * colorWords], &board.colors[lastRow * colorWords], nrAbove * colorWords * sizeof(board.colors[0]));
+	}
+
+	int newHeight{ board.height - nrRemoved };
+	for (int i = newHeight; i < board.height; i++)
+	{
+		board.filled[i] = 0;
+	}
+	std::memset(&board.colors[newHeight * colorWords], 0, nrRemoved * colorWords * sizeof(board.colors[0]));
+	board.height = newHeight;
+	board.revision++;
+	board.hash ^= HashRows<Width, Rows>(board.filled, firstFull, newHeight);
+	return nrRemoved;
+}
+
+template<int Width, int Rows>
+bool InsertGarbageRows(BasicBoard<Width, Rows>& board, int nrRows, int hole, int blockType)
+{
+	using Bits = typename BasicBoard<Width, Rows>::Bits;
+	const int colorWords{ BasicBoard<Width, Rows>::colorWords };
+	bool isKept{ board.height + nrRows <= Rows };
+	nrRows = nrRows < Rows ? nrRows : Rows;
+	int nrMoved{ isKept ? board.height : Rows - nrRows };
+	std::memmove(&board.filled[nrRows], &board.filled[0], nrMoved * sizeof(board.filled[0]));
+	std::memmove(&board.colors[nrRows * colorWords], &board.colors[0], nrMoved * colorWords * sizeof(board.colors[0]));
+
+	Bits bits{ Bits(BasicBoard<Width, Rows>::fullRow & ~(Bits(1) << hole)) };
+	for (int i = 0; i < nrRows; i++)
+	{
+		board.filled[i] = bits;
+		for (int j = 0; j < Width; j++)
+		{
+			SetColor(board, j, i, j == hole ? 0 : blockType);
+		}
+	}
+
+	// Every row moved, so the hash is taken again from scratch
+	board.height = nrMoved + nrRows;
+	board.hash = HashRows<Width, Rows>(board.filled, 0, board.height);
+	board.revision++;
+	return isKept;
+}
+
+// The game board and the research boards, each compiled with its own sizes
+template void ClearBoard(Board& board);
+template void LockPiece(Board& board, const PieceMask& piece, int x, int y, int blockType);
+template int ClearFullRows(Board& board, int firstRow, int nrRows);
+template bool InsertGarbageRows(Board& board, int nrRows, int hole, int blockType);
+template void ClearBoard(Board8x20& board);
+template void LockPiece(Board8x20& board, const PieceMask& piece, int x, int y, int blockType);
+template int ClearFullRows(Board8x20& board, int firstRow, int nrRows);
+template bool InsertGarbageRows(Board8x20& board, int nrRows, int hole, int blockType);
+template void ClearBoard(Board10x20& board);
+template void LockPiece(Board10x20& board, const PieceMask& piece, int x, int y, int blockType);
+template int ClearFullRows(Board10x20& board, int firstRow, int nrRows);
+template bool InsertGarbageRows(Board10x20& board, int nrRows, int hole, int blockType);
+template void ClearBoard(Board16x20& board);
+template void LockPiece(Board16x20& board, const PieceMask& piece, int x, int y, int blockType);
+template int ClearFullRows(Board16x20& board, int firstRow, int nrRows);
+template bool InsertGarbageRows(Board16x20& board, int nrRows, int hole, int blockType);
+template void ClearBoard(Board32x20& board);
+template void LockPiece(Board32x20& board, const PieceMask& piece, int x, int y, int blockType);
+template int ClearFullRows(Board32x20& board, int firstRow, int nrRows);
+template bool InsertGarbageRows(Board32x20& board, int nrRows, int hole, int blockType);
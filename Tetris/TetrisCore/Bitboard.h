@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include "BoardSize.h"
+#include "Zobrist.h"
+
+// Every row is a mask with one bit per column, bit 0 is the left column and row 0 is the bottom row.
+// The color of a cell is stored in 4 bits, so all colors of a row up to 16 wide fit in a single 64 bit word.
+// height is the number of rows, counted from the bottom, that can contain filled cells.
+// revision changes every time the filled cells change, so a renderer can tell when its copy is out of date.
+// hash is the Zobrist hash of the filled cells, kept up to date as pieces lock and rows clear.
+// The size is part of the type, so every board size gets its own code with the sizes folded in.
+template<int Width, int Rows>
+struct BasicBoard
+{
+	using Bits = typename BoardRow<Width>::Bits;
+	static constexpr int width{ Width };
+	static constexpr int rows{ Rows };
+	static constexpr int colorWords{ BoardRow<Width>::colorWords };
+	static constexpr Bits fullRow{ Bits((uint64_t(1) << Width) - 1) };
+
+	Bits filled[Rows];
+	uint64_t colors[Rows * colorWords];
+	int height;
+	uint32_t revision;
+	uint64_t hash;
+};
+
+// The board the game is played on, everything outside the research boards uses this one
+using Board = BasicBoard<g_BoardWidth, g_BoardRows>;
+// Boards for research, with 20 visible rows and the same hidden rows on top
+using Board8x20 = BasicBoard<8, 20 + g_HiddenRows>;
+using Board10x20 = BasicBoard<10, 20 + g_HiddenRows>;
+using Board16x20 = BasicBoard<16, 20 + g_HiddenRows>;
+using Board32x20 = BasicBoard<32, 20 + g_HiddenRows>;
+
+struct PieceCell
+{
+	int x, y;
+};
+
+// One shape of a piece: rows[0] is its bottom row and bit 0 its left column.
+// left and bottom give that corner relative to the position of the piece, cells hold the same four cells as offsets.
+struct PieceMask
+{
+	uint16_t rows[4];
+	int left;
+	int bottom;
+	int width;
+	int height;
+	PieceCell cells[4];
+};
+
+// Defined for the boards above only, in Bitboard.cpp
+template<int Width, int Rows>
+void ClearBoard(BasicBoard<Width, Rows>& board);
+template<int Width, int Rows>
+void LockPiece(BasicBoard<Width, Rows>& board, const PieceMask& piece, int x, int y, int blockType);
+template<int Width, int Rows>
+int ClearFullRows(BasicBoard<Width, Rows>& board, int firstRow, int nrRows);
+// Pushes the stack up by nrRows rows at the bottom that are full except for the hole column.
+// Returns false when that pushes filled cells out of the top, those are lost.
+template<int Width, int Rows>
+bool InsertGarbageRows(BasicBoard<Width, Rows>& board, int nrRows, int hole, int blockType);
+
+// Inlined, searching for placements calls this far more often than anything else
+template<int Width, int Rows>
+inline bool Collides(const BasicBoard<Width, Rows>& board, const PieceMask& piece, int x, int y)
+{
+	using Bits = typename BasicBoard<Width, Rows>::Bits;
+	int col{ x + piece.left };
+	int row{ y + piece.bottom };
+	if ((col < 0) | (col + piece.width > Width) | (row < 0) | (row + piece.height > Rows))
+	{
+		return true;
+	}
+
+	Bits overlap{};
+	for (int i = 0; i < piece.height; i++)
+	{
+		overlap |= board.filled[row + i] & Bits(Bits(piece.rows[i]) << col);
+	}
+	return overlap != 0;
+}
+
+template<int Width, int Rows>
+inline bool IsRowFull(const BasicBoard<Width, Rows>& board, int row)
+{
+	return board.filled[row] == BasicBoard<Width, Rows>::fullRow;
+}
+
+template<int Width, int Rows>
+inline bool IsFilled(const BasicBoard<Width, Rows>& board, int col, int row)
+{
+	return (board.filled[row] >> col) & 1;
+}
+
+// Where the color of a cell is, a row in one word needs no division by the cells per word
+template<int ColorWords>
+inline int GetColorWord(int col, int row)
+{
+	return ColorWords == 1 ? row : row * ColorWords + col / 16;
+}
+
+template<int ColorWords>
+inline int GetColorShift(int col)
+{
+	return ColorWords == 1 ? col * 4 : col % 16 * 4;
+}
+
+template<int Width, int Rows>
+inline int GetColor(const BasicBoard<Width, Rows>& board, int col, int row)
+{
+	const int colorWords{ BasicBoard<Width, Rows>::colorWords };
+	return int((board.colors[GetColorWord<colorWords>(col, row)] >> GetColorShift<colorWords>(col)) & 0xF);
+}
+
+template<int Width, int Rows>
+inline void SetColor(BasicBoard<Width, Rows>& board, int col, int row, int blockType)
+{
+	const int colorWords{ BasicBoard<Width, Rows>::colorWords };
+	int shift{ GetColorShift<colorWords>(col) };
+	uint64_t& colors{ board.colors[GetColorWord<colorWords>(col, row)] };
+	colors = (colors & ~(uint64_t(0xF) << shift)) | (uint64_t(blockType) << shift);
+}
@@ -0,0 +1,173 @@
+#include "BoardKernels.h"
+#if defined(TETRIS_X86_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef TETRIS_X86_KERNELS
+extern const BoardKernels g_Sse2Kernels;
+extern const BoardKernels g_Avx2Kernels;
+#endif
+
+const BoardKernels* SelectBoardKernels();
+bool HasSse2();
+bool HasAvx2();
+
+int CountBits(uint32_t bits)
+{
+	bits = bits - ((bits >> 1) & 0x55555555);
+	bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+	bits = (bits + (bits >> 4)) & 0x0F0F0F0F;
+	return int((bits * 0x01010101) >> 24);
+}
+
+void ScalarColumnHeights(const uint16_t* pRows, int nrRows, int16_t* pHeights, int16_t* pCounts)
+{
+	for (int j = 0; j < g_PaddedWidth; j++)
+	{
+		pHeights[j] = 0;
+		pCounts[j] = 0;
+	}
+	// Bottom up, every filled cell raises its column to that row
+	for (int i = 0; i < nrRows; i++)
+	{
+		int bits{ pRows[i] };
+		for (int j = 0; j < g_PaddedWidth; j++)
+		{
+			int filled{ (bits >> j) & 1 };
+			pHeights[j] = filled != 0 ? int16_t(i + 1) : pHeights[j];
+			pCounts[j] = int16_t(pCounts[j] + filled);
+		}
+	}
+}
+
+int ScalarHoles(const uint16_t* pRows, int nrRows)
+{
+	// Top down, every empty cell under a column that was covered already is a hole
+	uint32_t covered{};
+	int holes{};
+	for (int i = nrRows - 1; i >= 0; i--)
+	{
+		covered |= pRows[i];
+		holes += CountBits(covered & ~uint32_t(pRows[i]));
+	}
+	return holes;
+}
+
+int ScalarRowTransitions(const uint16_t* pRows, int nrRows)
+{
+	int transitions{};
+	for (int i = 0; i < nrRows; i++)
+	{
+		uint32_t walled{ uint32_t(pRows[i] << 1) | g_RowWalls };
+		transitions += CountBits((walled ^ (walled >> 1)) & g_RowPairs);
+	}
+	return transitions;
+}
+
+int ScalarColumnTransitions(const uint16_t* pRows, int nrRows)
+{
+	uint32_t below{ g_FullRow };
+	int transitions{};
+	for (int i = 0; i < nrRows; i++)
+	{
+		transitions += CountBits(below ^ pRows[i]);
+		below = pRows[i];
+	}
+	return transitions + CountBits(below);
+}
+
+int ScalarWellDepths(const int16_t* pHeights, int16_t* pDepths)
+{
+	int total{};
+	for (int j = 0; j < g_PaddedWidth; j++)
+	{
+		int depth{};
+		if (j < g_BoardWidth)
+		{
+			int left{ j == 0 ? g_BoardRows : pHeights[j - 1] };
+			int right{ j == g_BoardWidth - 1 ? g_BoardRows : pHeights[j + 1] };
+			int lowest{ left < right ? left : right };
+			depth = lowest > pHeights[j] ? lowest - pHeights[j] : 0;
+		}
+		pDepths[j] = int16_t(depth);
+		total += depth;
+	}
+	return total;
+}
+
+extern const BoardKernels g_ScalarKernels;
+const BoardKernels g_ScalarKernels{ "scalar", ScalarColumnHeights, ScalarHoles, ScalarRowTransitions, ScalarColumnTransitions, ScalarWellDepths };
+
+const BoardKernels& GetBoardKernels()
+{
+	static const BoardKernels& kernels{ *SelectBoardKernels() };
+	return kernels;
+}
+
+const BoardKernels* GetBoardKernels(KernelLevel level)
+{
+	switch (level)
+	{
+#ifdef TETRIS_X86_KERNELS
+	case KernelLevel::Avx2:
+		return HasAvx2() ? &g_Avx2Kernels : nullptr;
+	case KernelLevel::Sse2:
+		return HasSse2() ? &g_Sse2Kernels : nullptr;
+#endif
+	case KernelLevel::Scalar:
+		return &g_ScalarKernels;
+	default:
+		return nullptr;
+	}
+}
+
+const BoardKernels* SelectBoardKernels()
+{
+	const KernelLevel levels[]{ KernelLevel::Avx2, KernelLevel::Sse2 };
+	for (KernelLevel level : levels)
+	{
+		if (const BoardKernels* pKernels{ GetBoardKernels(level) })
+		{
+			return pKernels;
+		}
+	}
+	return &g_ScalarKernels;
+}
+
+#ifdef TETRIS_X86_KERNELS
+bool HasSse2()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return true;
+#elif defined(_MSC_VER)
+	int info[4]{};
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool HasAvx2()
+{
+#ifdef _MSC_VER
+	int info[4]{};
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	// The OS has to save the AVX registers too, which OSXSAVE and XCR0 tell
+	__cpuid(info, 1);
+	const int osxsaveAndAvx{ (1 << 27) | (1 << 28) };
+	if ((info[2] & osxsaveAndAvx) != osxsaveAndAvx || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include "BoardSize.h"
+
+// Board features for the computer players, worked out straight from the row masks.
+// Every kernel has a scalar version and, on x86, SSE2 and AVX2 versions. GetBoardKernels picks the best
+// one the CPU runs, once. The SIMD versions are compiled for newer CPUs than the rest of the game, so
+// their files only include headers without inline code, which could end up shared with the other files.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TETRIS_X86_KERNELS
+#endif
+
+// Per column arrays are padded to a whole vector of 16 bit lanes, the padding columns stay 0.
+// The rows passed to the kernels are arrays of g_BoardRows rows of which only the first nrRows count,
+// the SIMD kernels load all of them and mask off the rest.
+const int g_PaddedWidth{ 16 };
+static_assert(g_BoardWidth <= g_PaddedWidth, "the board doesn't fit the kernels");
+
+// A row shifted up one bit with both walls set, so neighbouring bits of it are the pairs of cells in the row
+const uint16_t g_RowWalls{ 1 | (1 << (g_BoardWidth + 1)) };
+const uint16_t g_RowPairs{ (1 << (g_BoardWidth + 1)) - 1 };
+
+enum class KernelLevel
+{
+	Scalar, Sse2, Avx2
+};
+
+struct BoardKernels
+{
+	const char* pName;
+	// Height of every column and the filled cells in it
+	void (*columnHeights)(const uint16_t* pRows, int nrRows, int16_t* pHeights, int16_t* pCounts);
+	// Empty cells with a filled cell somewhere above them
+	int (*holes)(const uint16_t* pRows, int nrRows);
+	// Changes between filled and empty along each row, the walls count as filled
+	int (*rowTransitions)(const uint16_t* pRows, int nrRows);
+	// Changes between filled and empty up each column, the floor counts as filled and the rows above as empty
+	int (*columnTransitions)(const uint16_t* pRows, int nrRows);
+	// How far each column is below both neighbours, the walls count as higher than the board. Returns the total.
+	int (*wellDepths)(const int16_t* pHeights, int16_t* pDepths);
+};
+
+const BoardKernels& GetBoardKernels();
+// The kernels of one level, nullptr when this build or this CPU doesn't have them
+const BoardKernels* GetBoardKernels(KernelLevel level);
@@ -0,0 +1,134 @@
+#include "BoardKernels.h"
+#ifdef TETRIS_X86_KERNELS
+#include <immintrin.h>
+
+// All 16 columns fit one register of 16 bit lanes, and so do 16 rows when whole rows are worked on at once
+
+extern const BoardKernels g_Avx2Kernels;
+
+__m256i Avx2CountBits(__m256i bits)
+{
+	bits = _mm256_sub_epi16(bits, _mm256_and_si256(_mm256_srli_epi16(bits, 1), _mm256_set1_epi16(0x5555)));
+	bits = _mm256_add_epi16(_mm256_and_si256(bits, _mm256_set1_epi16(0x3333)), _mm256_and_si256(_mm256_srli_epi16(bits, 2), _mm256_set1_epi16(0x3333)));
+	bits = _mm256_and_si256(_mm256_add_epi16(bits, _mm256_srli_epi16(bits, 4)), _mm256_set1_epi16(0x0F0F));
+	return _mm256_and_si256(_mm256_add_epi16(bits, _mm256_srli_epi16(bits, 8)), _mm256_set1_epi16(0x00FF));
+}
+
+int Avx2SumLanes(__m256i lanes)
+{
+	__m256i wide{ _mm256_madd_epi16(lanes, _mm256_set1_epi16(1)) };
+	__m128i sums{ _mm_add_epi32(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1)) };
+	sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+	sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sums);
+}
+
+void Avx2Heights(const uint16_t* pRows, int nrRows, __m256i& heights, __m256i& counts)
+{
+	const __m256i bits{ _mm256_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128,
+		256, 512, 1024, 2048, 4096, 8192, 16384, int16_t(0x8000)) };
+	heights = counts = _mm256_setzero_si256();
+	for (int i = 0; i < nrRows; i++)
+	{
+		__m256i row{ _mm256_set1_epi16(int16_t(pRows[i])) };
+		__m256i filled{ _mm256_cmpeq_epi16(_mm256_and_si256(row, bits), bits) };
+		heights = _mm256_max_epi16(heights, _mm256_and_si256(filled, _mm256_set1_epi16(int16_t(i + 1))));
+		counts = _mm256_sub_epi16(counts, filled);
+	}
+}
+
+void Avx2ColumnHeights(const uint16_t* pRows, int nrRows, int16_t* pHeights, int16_t* pCounts)
+{
+	__m256i heights, counts;
+	Avx2Heights(pRows, nrRows, heights, counts);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(pHeights), heights);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(pCounts), counts);
+}
+
+int Avx2Holes(const uint16_t* pRows, int nrRows)
+{
+	__m256i heights, counts;
+	Avx2Heights(pRows, nrRows, heights, counts);
+	return Avx2SumLanes(_mm256_sub_epi16(heights, counts));
+}
+
+// Rows are loaded straight from the caller's array as whole vectors, the rows left over after the last whole
+// one go through a zeroed copy so nothing past the array is read. The rows from nrRows up are masked off.
+const int g_Avx2Chunks{ (g_BoardRows + 15) / 16 };
+
+void Avx2LoadRows(const uint16_t* pRows, int nrRows, __m256i* pChunks)
+{
+	const __m256i lanes{ _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15) };
+	for (int i = 0; i < g_Avx2Chunks; i++)
+	{
+		if ((i + 1) * 16 <= g_BoardRows)
+		{
+			pChunks[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pRows + i * 16));
+		}
+		else
+		{
+			alignas(32) uint16_t rest[16]{};
+			for (int k = 0; i * 16 + k < g_BoardRows; k++)
+			{
+				rest[k] = pRows[i * 16 + k];
+			}
+			pChunks[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(rest));
+		}
+		__m256i isUsed{ _mm256_cmpgt_epi16(_mm256_set1_epi16(int16_t(nrRows)), _mm256_add_epi16(lanes, _mm256_set1_epi16(int16_t(i * 16)))) };
+		pChunks[i] = _mm256_and_si256(pChunks[i], isUsed);
+	}
+}
+
+int Avx2RowTransitions(const uint16_t* pRows, int nrRows)
+{
+	__m256i chunks[g_Avx2Chunks];
+	Avx2LoadRows(pRows, nrRows, chunks);
+	const __m256i walls{ _mm256_set1_epi16(int16_t(g_RowWalls)) };
+	const __m256i pairs{ _mm256_set1_epi16(int16_t(g_RowPairs)) };
+	__m256i total{ _mm256_setzero_si256() };
+	for (int i = 0; i < g_Avx2Chunks; i++)
+	{
+		__m256i walled{ _mm256_or_si256(_mm256_slli_epi16(chunks[i], 1), walls) };
+		total = _mm256_add_epi16(total, Avx2CountBits(_mm256_and_si256(_mm256_xor_si256(walled, _mm256_srli_epi16(walled, 1)), pairs)));
+	}
+	return Avx2SumLanes(total) - 2 * (g_Avx2Chunks * 16 - nrRows);
+}
+
+int Avx2ColumnTransitions(const uint16_t* pRows, int nrRows)
+{
+	__m256i chunks[g_Avx2Chunks + 1];
+	Avx2LoadRows(pRows, nrRows, chunks);
+	chunks[g_Avx2Chunks] = _mm256_setzero_si256();
+	__m256i total{ _mm256_setzero_si256() };
+	for (int i = 0; i < g_Avx2Chunks; i++)
+	{
+		// The next lane across both halves: the upper half of this vector and the lower half of the next one
+		// sit behind each half, so one align moves every row above its row
+		__m256i next{ _mm256_permute2x128_si256(chunks[i], chunks[i + 1], 0x21) };
+		__m256i above{ _mm256_alignr_epi8(next, chunks[i], 2) };
+		total = _mm256_add_epi16(total, Avx2CountBits(_mm256_xor_si256(chunks[i], above)));
+	}
+	__m128i floor{ _mm_cvtsi32_si128(~_mm256_cvtsi256_si32(chunks[0]) & g_FullRow) };
+	return Avx2SumLanes(_mm256_add_epi16(total, Avx2CountBits(_mm256_setr_m128i(floor, _mm_setzero_si128()))));
+}
+
+int Avx2WellDepths(const int16_t* pHeights, int16_t* pDepths)
+{
+	// The neighbours are the heights moved one lane either way across both halves, the padding columns are 0
+	// so the walls can be or'ed in
+	__m256i heights{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pHeights)) };
+	__m256i left{ _mm256_alignr_epi8(heights, _mm256_permute2x128_si256(heights, heights, 0x08), 14) };
+	__m256i right{ _mm256_alignr_epi8(_mm256_permute2x128_si256(heights, heights, 0x81), heights, 2) };
+	const __m256i lanes{ _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15) };
+	const __m256i walls{ _mm256_set1_epi16(g_BoardRows) };
+	left = _mm256_or_si256(left, _mm256_and_si256(_mm256_cmpeq_epi16(lanes, _mm256_setzero_si256()), walls));
+	right = _mm256_or_si256(right, _mm256_and_si256(_mm256_cmpeq_epi16(lanes, _mm256_set1_epi16(g_BoardWidth - 1)), walls));
+
+	__m256i depths{ _mm256_max_epi16(_mm256_sub_epi16(_mm256_min_epi16(left, right), heights), _mm256_setzero_si256()) };
+	depths = _mm256_and_si256(depths, _mm256_cmpgt_epi16(_mm256_set1_epi16(g_BoardWidth), lanes));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDepths), depths);
+	return Avx2SumLanes(depths);
+}
+
+const BoardKernels g_Avx2Kernels{ "avx2", Avx2ColumnHeights, Avx2Holes, Avx2RowTransitions, Avx2ColumnTransitions, Avx2WellDepths };
+#endif
@@ -0,0 +1,147 @@
+#include "BoardKernels.h"
+#ifdef TETRIS_X86_KERNELS
+#include <emmintrin.h>
+
+// Columns are 16 bit lanes, 8 to a register, and so are rows when whole rows are worked on at once
+
+extern const BoardKernels g_Sse2Kernels;
+
+// Bits in every 16 bit lane, by adding up ever wider neighbouring groups of bits
+__m128i Sse2CountBits(__m128i bits)
+{
+	bits = _mm_sub_epi16(bits, _mm_and_si128(_mm_srli_epi16(bits, 1), _mm_set1_epi16(0x5555)));
+	bits = _mm_add_epi16(_mm_and_si128(bits, _mm_set1_epi16(0x3333)), _mm_and_si128(_mm_srli_epi16(bits, 2), _mm_set1_epi16(0x3333)));
+	bits = _mm_and_si128(_mm_add_epi16(bits, _mm_srli_epi16(bits, 4)), _mm_set1_epi16(0x0F0F));
+	return _mm_and_si128(_mm_add_epi16(bits, _mm_srli_epi16(bits, 8)), _mm_set1_epi16(0x00FF));
+}
+
+int Sse2SumLanes(__m128i lanes)
+{
+	__m128i sums{ _mm_madd_epi16(lanes, _mm_set1_epi16(1)) };
+	sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+	sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sums);
+}
+
+void Sse2Heights(const uint16_t* pRows, int nrRows, __m128i* pHeights, __m128i* pCounts)
+{
+	const __m128i lowBits{ _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128) };
+	const __m128i highBits{ _mm_slli_epi16(lowBits, 8) };
+	pHeights[0] = pHeights[1] = pCounts[0] = pCounts[1] = _mm_setzero_si128();
+	for (int i = 0; i < nrRows; i++)
+	{
+		__m128i row{ _mm_set1_epi16(int16_t(pRows[i])) };
+		__m128i height{ _mm_set1_epi16(int16_t(i + 1)) };
+		// All ones in the lanes of the filled columns, rows go up so those columns rise to this row
+		__m128i lowFilled{ _mm_cmpeq_epi16(_mm_and_si128(row, lowBits), lowBits) };
+		__m128i highFilled{ _mm_cmpeq_epi16(_mm_and_si128(row, highBits), highBits) };
+		pHeights[0] = _mm_max_epi16(pHeights[0], _mm_and_si128(lowFilled, height));
+		pHeights[1] = _mm_max_epi16(pHeights[1], _mm_and_si128(highFilled, height));
+		pCounts[0] = _mm_sub_epi16(pCounts[0], lowFilled);
+		pCounts[1] = _mm_sub_epi16(pCounts[1], highFilled);
+	}
+}
+
+void Sse2ColumnHeights(const uint16_t* pRows, int nrRows, int16_t* pHeights, int16_t* pCounts)
+{
+	__m128i heights[2], counts[2];
+	Sse2Heights(pRows, nrRows, heights, counts);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pHeights), heights[0]);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pHeights + 8), heights[1]);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pCounts), counts[0]);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pCounts + 8), counts[1]);
+}
+
+int Sse2Holes(const uint16_t* pRows, int nrRows)
+{
+	// Every cell below a column's height that isn't filled is a hole
+	__m128i heights[2], counts[2];
+	Sse2Heights(pRows, nrRows, heights, counts);
+	return Sse2SumLanes(_mm_add_epi16(_mm_sub_epi16(heights[0], counts[0]), _mm_sub_epi16(heights[1], counts[1])));
+}
+
+// Rows are loaded straight from the caller's array as whole vectors, the rows left over after the last whole
+// one go through a zeroed copy so nothing past the array is read. The rows from nrRows up are masked off.
+const int g_Sse2Chunks{ (g_BoardRows + 7) / 8 };
+
+void Sse2LoadRows(const uint16_t* pRows, int nrRows, __m128i* pChunks)
+{
+	const __m128i lanes{ _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7) };
+	for (int i = 0; i < g_Sse2Chunks; i++)
+	{
+		if ((i + 1) * 8 <= g_BoardRows)
+		{
+			pChunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRows + i * 8));
+		}
+		else
+		{
+			alignas(16) uint16_t rest[8]{};
+			for (int k = 0; i * 8 + k < g_BoardRows; k++)
+			{
+				rest[k] = pRows[i * 8 + k];
+			}
+			pChunks[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(rest));
+		}
+		__m128i isUsed{ _mm_cmplt_epi16(_mm_add_epi16(lanes, _mm_set1_epi16(int16_t(i * 8))), _mm_set1_epi16(int16_t(nrRows))) };
+		pChunks[i] = _mm_and_si128(pChunks[i], isUsed);
+	}
+}
+
+int Sse2RowTransitions(const uint16_t* pRows, int nrRows)
+{
+	__m128i chunks[g_Sse2Chunks];
+	Sse2LoadRows(pRows, nrRows, chunks);
+	const __m128i walls{ _mm_set1_epi16(int16_t(g_RowWalls)) };
+	const __m128i pairs{ _mm_set1_epi16(int16_t(g_RowPairs)) };
+	__m128i total{ _mm_setzero_si128() };
+	for (int i = 0; i < g_Sse2Chunks; i++)
+	{
+		__m128i walled{ _mm_or_si128(_mm_slli_epi16(chunks[i], 1), walls) };
+		total = _mm_add_epi16(total, Sse2CountBits(_mm_and_si128(_mm_xor_si128(walled, _mm_srli_epi16(walled, 1)), pairs)));
+	}
+	// The masked off rows each count their two walls
+	return Sse2SumLanes(total) - 2 * (g_Sse2Chunks * 8 - nrRows);
+}
+
+int Sse2ColumnTransitions(const uint16_t* pRows, int nrRows)
+{
+	__m128i chunks[g_Sse2Chunks + 1];
+	Sse2LoadRows(pRows, nrRows, chunks);
+	chunks[g_Sse2Chunks] = _mm_setzero_si128();
+	__m128i total{ _mm_setzero_si128() };
+	for (int i = 0; i < g_Sse2Chunks; i++)
+	{
+		// The row above each row is the next lane, the first lane of the next vector for the last one
+		__m128i above{ _mm_or_si128(_mm_srli_si128(chunks[i], 2), _mm_slli_si128(chunks[i + 1], 14)) };
+		total = _mm_add_epi16(total, Sse2CountBits(_mm_xor_si128(chunks[i], above)));
+	}
+	// The floor against the bottom row, as one more lane
+	__m128i floor{ _mm_cvtsi32_si128(~_mm_cvtsi128_si32(chunks[0]) & g_FullRow) };
+	return Sse2SumLanes(_mm_add_epi16(total, Sse2CountBits(floor)));
+}
+
+int Sse2WellDepths(const int16_t* pHeights, int16_t* pDepths)
+{
+	// The neighbours are the heights moved one lane either way, the padding columns are 0 so the walls can be or'ed in
+	__m128i low{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pHeights)) };
+	__m128i high{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pHeights + 8)) };
+	__m128i lowLeft{ _mm_or_si128(_mm_slli_si128(low, 2), _mm_cvtsi32_si128(g_BoardRows)) };
+	__m128i highLeft{ _mm_or_si128(_mm_slli_si128(high, 2), _mm_srli_si128(low, 14)) };
+	__m128i lowRight{ _mm_or_si128(_mm_srli_si128(low, 2), _mm_slli_si128(high, 14)) };
+	__m128i highRight{ _mm_srli_si128(high, 2) };
+	const __m128i lanes{ _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7) };
+	const __m128i rightWall{ _mm_set1_epi16(int16_t(g_BoardWidth - 1)) };
+	lowRight = _mm_or_si128(lowRight, _mm_and_si128(_mm_cmpeq_epi16(lanes, rightWall), _mm_set1_epi16(g_BoardRows)));
+	highRight = _mm_or_si128(highRight, _mm_and_si128(_mm_cmpeq_epi16(_mm_add_epi16(lanes, _mm_set1_epi16(8)), rightWall), _mm_set1_epi16(g_BoardRows)));
+
+	__m128i lowDepths{ _mm_max_epi16(_mm_sub_epi16(_mm_min_epi16(lowLeft, lowRight), low), _mm_setzero_si128()) };
+	__m128i highDepths{ _mm_max_epi16(_mm_sub_epi16(_mm_min_epi16(highLeft, highRight), high), _mm_setzero_si128()) };
+	lowDepths = _mm_and_si128(lowDepths, _mm_cmplt_epi16(lanes, _mm_set1_epi16(g_BoardWidth)));
+	highDepths = _mm_and_si128(highDepths, _mm_cmplt_epi16(_mm_add_epi16(lanes, _mm_set1_epi16(8)), _mm_set1_epi16(g_BoardWidth)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pDepths), lowDepths);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pDepths + 8), highDepths);
+	return Sse2SumLanes(_mm_add_epi16(lowDepths, highDepths));
+}
+
+const BoardKernels g_Sse2Kernels{ "sse2", Sse2ColumnHeights, Sse2Holes, Sse2RowTransitions, Sse2ColumnTransitions, Sse2WellDepths };
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+// Playfield size: 10 columns and 16 visible rows, with some hidden rows on top so a piece can spawn and rotate
+const int g_BoardWidth{ 10 };
+const int g_VisibleRows{ 16 };
+const int g_HiddenRows{ 4 };
+const int g_BoardRows{ g_VisibleRows + g_HiddenRows };
+const uint16_t g_FullRow{ (1 << g_BoardWidth) - 1 };
+
+// How a row of a board that many columns wide is stored. Only these widths exist, any other one fails to compile.
+// Bits holds one bit per column. The colors take 4 bits per cell in colorWords 64 bit words.
+// The Zobrist keys are combined per chunkBits columns, so hashing a row takes one lookup per chunk.
+template<int Width>
+struct BoardRow;
+
+template<>
+struct BoardRow<8>
+{
+	using Bits = uint8_t;
+	static constexpr int colorWords{ 1 };
+	static constexpr int chunkBits{ 8 };
+};
+
+template<>
+struct BoardRow<10>
+{
+	using Bits = uint16_t;
+	static constexpr int colorWords{ 1 };
+	static constexpr int chunkBits{ 5 };
+};
+
+template<>
+struct BoardRow<16>
+{
+	using Bits = uint16_t;
+	static constexpr int colorWords{ 1 };
+	static constexpr int chunkBits{ 8 };
+};
+
+template<>
+struct BoardRow<32>
+{
+	using Bits = uint32_t;
+	static constexpr int colorWords{ 2 };
+	static constexpr int chunkBits{ 8 };
+};
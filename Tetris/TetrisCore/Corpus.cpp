@@ -0,0 +1,252 @@
+#include "Corpus.h"
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr uint64_t AlignUp(uint64_t position)
+{
+	return (position + g_CorpusAlignment - 1) & ~(g_CorpusAlignment - 1);
+}
+
+bool WriteColumn(FILE* pFile, uint64_t& position, const void* pData, uint64_t size, uint64_t& column);
+bool MapFile(const char* path, const uint8_t*& pData, uint64_t& size);
+void UnmapFile(const uint8_t* pData, uint64_t size);
+bool IsColumnInFile(const Corpus& corpus, uint64_t column, uint64_t size);
+
+bool OpenCorpusWriter(CorpusWriter& writer, const char* path)
+{
+	writer = CorpusWriter{};
+	writer.pFile = fopen(path, "wb");
+	if (!writer.pFile)
+	{
+		return false;
+	}
+	writer.offsets.push_back(0);
+	// The header is written again with the column positions when the corpus is closed
+	uint8_t start[AlignUp(sizeof(CorpusHeader))]{};
+	return fwrite(start, sizeof(start), 1, writer.pFile) == 1;
+}
+
+bool AddToCorpus(CorpusWriter& writer, const Replay& replay)
+{
+	if (!replay.events.empty() && fwrite(replay.events.data(), replay.events.size(), 1, writer.pFile) != 1)
+	{
+		return false;
+	}
+	const ReplayHeader& header{ replay.header };
+	writer.eventBytes += replay.events.size();
+	writer.offsets.push_back(writer.eventBytes);
+	writer.seeds.push_back(header.seed);
+	writer.boardHashes.push_back(header.boardHash);
+	writer.gravity.push_back(header.gravityPerStep);
+	writer.endSteps.push_back(header.endStep);
+	writer.pieces.push_back(header.blocksUsed);
+	writer.lines.push_back(header.lines);
+	writer.scores.push_back(header.score);
+	writer.gameOvers.push_back(uint8_t(header.isGameOver));
+	return true;
+}
+
+bool CloseCorpusWriter(CorpusWriter& writer)
+{
+	if (!writer.pFile)
+	{
+		return false;
+	}
+	CorpusHeader header{};
+	memcpy(header.magic, g_CorpusMagic, sizeof(g_CorpusMagic));
+	header.version = g_CorpusVersion;
+	header.nrGames = writer.seeds.size();
+	header.events = AlignUp(sizeof(CorpusHeader));
+	header.eventBytes = writer.eventBytes;
+
+	uint64_t position{ header.events + header.eventBytes };
+	uint64_t nrGames{ header.nrGames };
+	bool isWritten{ WriteColumn(writer.pFile, position, writer.offsets.data(), (nrGames + 1) * sizeof(uint64_t), header.offsets)
+		&& WriteColumn(writer.pFile, position, writer.seeds.data(), nrGames * sizeof(uint64_t), header.seeds)
+		&& WriteColumn(writer.pFile, position, writer.boardHashes.data(), nrGames * sizeof(uint64_t), header.boardHashes)
+		&& WriteColumn(writer.pFile, position, writer.gravity.data(), nrGames * sizeof(uint32_t), header.gravity)
+		&& WriteColumn(writer.pFile, position, writer.endSteps.data(), nrGames * sizeof(uint32_t), header.endSteps)
+		&& WriteColumn(writer.pFile, position, writer.pieces.data(), nrGames * sizeof(uint32_t), header.pieces)
+		&& WriteColumn(writer.pFile, position, writer.lines.data(), nrGames * sizeof(uint32_t), header.lines)
+		&& WriteColumn(writer.pFile, position, writer.scores.data(), nrGames * sizeof(uint32_t), header.scores)
+		&& WriteColumn(writer.pFile, position, writer.gameOvers.data(), nrGames * sizeof(uint8_t), header.gameOvers) };
+	isWritten = isWritten && fseek(writer.pFile, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, writer.pFile) == 1;
+	isWritten = fclose(writer.pFile) == 0 && isWritten;
+	writer = CorpusWriter{};
+	return isWritten;
+}
+
+bool OpenCorpus(Corpus& corpus, const char* path)
+{
+	corpus = Corpus{};
+	if (!MapFile(path, corpus.pData, corpus.size))
+	{
+		return false;
+	}
+
+	CorpusHeader header{};
+	bool isValid{ corpus.size >= sizeof(header) };
+	if (isValid)
+	{
+		memcpy(&header, corpus.pData, sizeof(header));
+		isValid = memcmp(header.magic, g_CorpusMagic, sizeof(g_CorpusMagic)) == 0 && header.version == g_CorpusVersion;
+	}
+	// A count that doesn't fit in the file would overflow the sizes below
+	uint64_t nrGames{ header.nrGames };
+	isValid = isValid && nrGames < corpus.size
+		&& IsColumnInFile(corpus, header.events, header.eventBytes)
+		&& IsColumnInFile(corpus, header.offsets, (nrGames + 1) * sizeof(uint64_t))
+		&& IsColumnInFile(corpus, header.seeds, nrGames * sizeof(uint64_t))
+		&& IsColumnInFile(corpus, header.boardHashes, nrGames * sizeof(uint64_t))
+		&& IsColumnInFile(corpus, header.gravity, nrGames * sizeof(uint32_t))
+		&& IsColumnInFile(corpus, header.endSteps, nrGames * sizeof(uint32_t))
+		&& IsColumnInFile(corpus, header.pieces, nrGames * sizeof(uint32_t))
+		&& IsColumnInFile(corpus, header.lines, nrGames * sizeof(uint32_t))
+		&& IsColumnInFile(corpus, header.scores, nrGames * sizeof(uint32_t))
+		&& IsColumnInFile(corpus, header.gameOvers, nrGames * sizeof(uint8_t));
+	if (!isValid)
+	{
+		CloseCorpus(corpus);
+		return false;
+	}
+
+	const uint8_t* pData{ corpus.pData };
+	corpus.nrGames = nrGames;
+	corpus.pEvents = pData + header.events;
+	corpus.eventBytes = header.eventBytes;
+	corpus.pOffsets = reinterpret_cast<const uint64_t*>(pData + header.offsets);
+	corpus.pSeeds = reinterpret_cast<const uint64_t*>(pData + header.seeds);
+	corpus.pBoardHashes = reinterpret_cast<const uint64_t*>(pData + header.boardHashes);
+	corpus.pGravity = reinterpret_cast<const uint32_t*>(pData + header.gravity);
+	corpus.pEndSteps = reinterpret_cast<const uint32_t*>(pData + header.endSteps);
+	corpus.pPieces = reinterpret_cast<const uint32_t*>(pData + header.pieces);
+	corpus.pLines = reinterpret_cast<const uint32_t*>(pData + header.lines);
+	corpus.pScores = reinterpret_cast<const uint32_t*>(pData + header.scores);
+	corpus.pGameOvers = pData + header.gameOvers;
+	return true;
+}
+
+void CloseCorpus(Corpus& corpus)
+{
+	if (corpus.pData)
+	{
+		UnmapFile(corpus.pData, corpus.size);
+	}
+	corpus = Corpus{};
+}
+
+bool GetCorpusReplay(const Corpus& corpus, uint64_t game, ReplayView& replay)
+{
+	uint64_t first{ corpus.pOffsets[game] };
+	uint64_t end{ corpus.pOffsets[game + 1] };
+	if (first > end || end > corpus.eventBytes || end - first > UINT32_MAX)
+	{
+		return false;
+	}
+	replay = ReplayView{ corpus.pSeeds[game], corpus.pGravity[game], corpus.pEndSteps[game], corpus.pEvents + first, uint32_t(end - first) };
+	return true;
+}
+
+ReplayHeader GetCorpusHeader(const Corpus& corpus, uint64_t game)
+{
+	ReplayHeader header{};
+	header.seed = corpus.pSeeds[game];
+	header.boardHash = corpus.pBoardHashes[game];
+	header.gravityPerStep = corpus.pGravity[game];
+	header.endStep = corpus.pEndSteps[game];
+	header.blocksUsed = corpus.pPieces[game];
+	header.lines = corpus.pLines[game];
+	header.score = corpus.pScores[game];
+	header.isGameOver = corpus.pGameOvers[game];
+	return header;
+}
+
+bool WriteColumn(FILE* pFile, uint64_t& position, const void* pData, uint64_t size, uint64_t& column)
+{
+	const uint8_t padding[g_CorpusAlignment]{};
+	uint64_t nrPadding{ AlignUp(position) - position };
+	if (nrPadding > 0 && fwrite(padding, size_t(nrPadding), 1, pFile) != 1)
+	{
+		return false;
+	}
+	column = position + nrPadding;
+	position = column + size;
+	return size == 0 || fwrite(pData, size_t(size), 1, pFile) == 1;
+}
+
+bool IsColumnInFile(const Corpus& corpus, uint64_t column, uint64_t size)
+{
+	// Columns are aligned, so the pointers into them are too
+	return column % g_CorpusAlignment == 0 && column <= corpus.size && size <= corpus.size - column;
+}
+
+#ifdef _WIN32
+bool MapFile(const char* path, const uint8_t*& pData, uint64_t& size)
+{
+	HANDLE file{ CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize{};
+	HANDLE mapping{ nullptr };
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	CloseHandle(file);
+	if (!mapping)
+	{
+		return false;
+	}
+	// The view keeps the mapping open
+	pData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	CloseHandle(mapping);
+	size = uint64_t(fileSize.QuadPart);
+	return pData != nullptr;
+}
+
+void UnmapFile(const uint8_t* pData, uint64_t)
+{
+	UnmapViewOfFile(pData);
+}
+#else
+bool MapFile(const char* path, const uint8_t*& pData, uint64_t& size)
+{
+	int file{ open(path, O_RDONLY) };
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat info{};
+	void* pMapped{ MAP_FAILED };
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		pMapped = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+	}
+	close(file);
+	if (pMapped == MAP_FAILED)
+	{
+		return false;
+	}
+	// Queries go through the columns front to back, so the kernel can read far ahead
+	madvise(pMapped, size_t(info.st_size), MADV_SEQUENTIAL);
+	pData = static_cast<const uint8_t*>(pMapped);
+	size = uint64_t(info.st_size);
+	return true;
+}
+
+void UnmapFile(const uint8_t* pData, uint64_t size)
+{
+	munmap(const_cast<uint8_t*>(pData), size_t(size));
+}
+#endif
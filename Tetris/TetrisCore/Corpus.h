@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "Replay.h"
+
+// Many recorded games in one file, laid out in columns so a query only reads the columns it needs.
+// The file is the header, the event bytes of all games one after the other, then one array per column,
+// every part starting on a 64 byte boundary. The offsets column has one more entry than there are games,
+// game i's events run from offsets[i] to offsets[i + 1] in the events.
+// Readers map the whole file and point straight into it, the binary format is the layout in memory.
+const char g_CorpusMagic[4]{ 'T', 'C', 'O', 'R' };
+const uint32_t g_CorpusVersion{ 2 }; // follows the replay version of the events
+const uint64_t g_CorpusAlignment{ 64 };
+
+// Where every column starts in the file
+struct CorpusHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t nrGames;
+	uint64_t events; // uint8_t, eventBytes of them
+	uint64_t eventBytes;
+	uint64_t offsets; // uint64_t
+	uint64_t seeds; // uint64_t
+	uint64_t boardHashes; // uint64_t
+	uint64_t gravity; // uint32_t, the gravityPerStep of every game
+	uint64_t endSteps; // uint32_t
+	uint64_t pieces; // uint32_t
+	uint64_t lines; // uint32_t
+	uint64_t scores; // uint32_t
+	uint64_t gameOvers; // uint8_t, 1 when the game ended by topping out
+};
+static_assert(sizeof(CorpusHeader) == 104, "binary corpus layout changed");
+
+// The events go to the file as games are added, the other columns are kept until the corpus is closed
+struct CorpusWriter
+{
+	FILE* pFile;
+	uint64_t eventBytes;
+	std::vector<uint64_t> offsets;
+	std::vector<uint64_t> seeds;
+	std::vector<uint64_t> boardHashes;
+	std::vector<uint32_t> gravity;
+	std::vector<uint32_t> endSteps;
+	std::vector<uint32_t> pieces;
+	std::vector<uint32_t> lines;
+	std::vector<uint32_t> scores;
+	std::vector<uint8_t> gameOvers;
+};
+
+// All return false when the file can't be opened, written or isn't a corpus of this version
+bool OpenCorpusWriter(CorpusWriter& writer, const char* path);
+bool AddToCorpus(CorpusWriter& writer, const Replay& replay);
+bool CloseCorpusWriter(CorpusWriter& writer);
+
+// A mapped corpus, the columns point into the mapping
+struct Corpus
+{
+	const uint8_t* pData;
+	uint64_t size;
+	uint64_t nrGames;
+	const uint8_t* pEvents;
+	uint64_t eventBytes;
+	const uint64_t* pOffsets;
+	const uint64_t* pSeeds;
+	const uint64_t* pBoardHashes;
+	const uint32_t* pGravity;
+	const uint32_t* pEndSteps;
+	const uint32_t* pPieces;
+	const uint32_t* pLines;
+	const uint32_t* pScores;
+	const uint8_t* pGameOvers;
+};
+
+bool OpenCorpus(Corpus& corpus, const char* path);
+void CloseCorpus(Corpus& corpus);
+// Points into the mapping, returns false when the game's offsets are broken
+bool GetCorpusReplay(const Corpus& corpus, uint64_t game, ReplayView& replay);
+// The recorded game's header as far as the columns keep it, without the magic, version and event counts
+ReplayHeader GetCorpusHeader(const Corpus& corpus, uint64_t game);
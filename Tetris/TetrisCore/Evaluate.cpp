@@ -0,0 +1,55 @@
+#include "Evaluate.h"
+
+void LockIntoRows(const uint16_t* pRows, int nrRows, const PieceMask& piece, int x, int y, LockedRows& locked)
+{
+	int col{ x + piece.left };
+	int row{ y + piece.bottom };
+	int top{ row + piece.height > nrRows ? row + piece.height : nrRows };
+	locked.nrRows = 0;
+	locked.nrCleared = 0;
+	for (int i = 0; i < top; i++)
+	{
+		uint16_t bits{ pRows[i] };
+		if (i >= row && i < row + piece.height)
+		{
+			bits |= uint16_t(piece.rows[i - row] << col);
+		}
+		if (bits == g_FullRow)
+		{
+			locked.nrCleared++;
+		}
+		else
+		{
+			locked.rows[locked.nrRows++] = bits;
+		}
+	}
+	while (locked.nrRows > 0 && locked.rows[locked.nrRows - 1] == 0)
+	{
+		locked.nrRows--;
+	}
+}
+
+BoardFeatures GetBoardFeatures(const uint16_t* pRows, int nrRows)
+{
+	const BoardKernels& kernels{ GetBoardKernels() };
+	alignas(32) int16_t heights[g_PaddedWidth];
+	alignas(32) int16_t counts[g_PaddedWidth];
+	alignas(32) int16_t depths[g_PaddedWidth];
+	kernels.columnHeights(pRows, nrRows, heights, counts);
+
+	BoardFeatures features{};
+	for (int j = 0; j < g_PaddedWidth; j++)
+	{
+		features.totalHeight += heights[j];
+		features.holes += heights[j] - counts[j];
+	}
+	for (int j = 0; j < g_BoardWidth - 1; j++)
+	{
+		int step{ heights[j] - heights[j + 1] };
+		features.bumpiness += step < 0 ? -step : step;
+	}
+	features.wells = kernels.wellDepths(heights, depths);
+	features.rowTransitions = kernels.rowTransitions(pRows, nrRows);
+	features.columnTransitions = kernels.columnTransitions(pRows, nrRows);
+	return features;
+}
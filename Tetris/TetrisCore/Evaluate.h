@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include "Bitboard.h"
+#include "BoardKernels.h"
+
+// Board evaluation for the computer players, a weighted sum of features from the board kernels
+
+struct EvalWeights
+{
+	float height;
+	float holes;
+	float bumpiness;
+	float wells;
+	float rowTransitions;
+	float columnTransitions;
+	float lines;
+};
+
+const EvalWeights g_DefaultWeights{ -0.51f, -0.36f, -0.18f, -0.1f, -0.1f, -0.1f, 0.76f };
+
+struct BoardFeatures
+{
+	int totalHeight;
+	int holes; // empty cells with a filled cell somewhere above them
+	int bumpiness; // height differences between neighbouring columns
+	int wells; // how far columns are below both neighbours, the walls count as higher than any column
+	int rowTransitions;
+	int columnTransitions;
+};
+
+// The rows of a board after a piece locked into it and the full ones were dropped
+struct LockedRows
+{
+	uint16_t rows[g_BoardRows];
+	int nrRows; // rows up to the highest one with a filled cell
+	int nrCleared;
+};
+
+void LockIntoRows(const uint16_t* pRows, int nrRows, const PieceMask& piece, int x, int y, LockedRows& locked);
+BoardFeatures GetBoardFeatures(const uint16_t* pRows, int nrRows);
+
+inline float EvaluateBoard(const BoardFeatures& features, const EvalWeights& weights)
+{
+	return weights.height * features.totalHeight + weights.holes * features.holes
+		+ weights.bumpiness * features.bumpiness + weights.wells * features.wells
+		+ weights.rowTransitions * features.rowTransitions + weights.columnTransitions * features.columnTransitions;
+}
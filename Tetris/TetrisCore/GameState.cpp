@@ -0,0 +1,214 @@
+#include "GameState.h"
+#include <climits>
+
+void Drop(GameState& state);
+void Lock(GameState& state);
+void Spawn(GameState& state);
+
+void NewGame(GameState& state, uint64_t seed, float gravity)
+{
+	ClearBoard(state.board);
+	state.x = 0;
+	state.y = 0;
+	state.figure = 0;
+	state.rotation = 0;
+	state.isMoving = false;
+	state.isGameOver = false;
+	state.counter = 0;
+	state.blocksUsed = 0;
+	state.lines = 0;
+	for (int& clears : state.clears)
+	{
+		clears = 0;
+	}
+	state.score = 0;
+	state.gravityPerStep = uint32_t(gravity * g_GravityUnit / g_StepsPerSecond + 0.5f);
+	// Start with a full unit so the first step spawns a piece right away
+	state.gravityProgress = g_GravityUnit;
+
+	state.seed = seed;
+	SeedBag(state.bag, seed);
+	FillPieceQueue(state.bag, state.queue, g_QueueLength);
+}
+
+void Step(GameState& state, uint8_t input)
+{
+	if (state.isGameOver)
+	{
+		return;
+	}
+
+	ApplyInput(state, input);
+
+	while (state.gravityProgress >= g_GravityUnit && !state.isGameOver)
+	{
+		state.gravityProgress -= g_GravityUnit;
+		if (state.isMoving)
+		{
+			Drop(state);
+		}
+		else
+		{
+			Spawn(state);
+		}
+	}
+	state.gravityProgress += state.gravityPerStep;
+	state.counter++;
+}
+
+int StepsUntilDrop(const GameState& state)
+{
+	if (state.isGameOver || state.gravityPerStep == 0)
+	{
+		return INT_MAX;
+	}
+	if (state.gravityProgress >= g_GravityUnit)
+	{
+		return 0;
+	}
+	return int((g_GravityUnit - state.gravityProgress + state.gravityPerStep - 1) / state.gravityPerStep);
+}
+
+void SkipSteps(GameState& state, int nrSteps)
+{
+	// Same result as nrSteps calls to Step without input, only valid while no piece drops in between
+	if (state.isGameOver)
+	{
+		return;
+	}
+	state.gravityProgress += uint32_t(nrSteps) * state.gravityPerStep;
+	state.counter += nrSteps;
+}
+
+float GetFallOffset(const GameState& state, float stepFraction)
+{
+	// How far the moving piece has fallen towards the row below, used to draw it between two steps
+	if (!state.isMoving || Collides(state.board, GetPieceMask(state.figure, state.rotation), state.x, state.y - 1))
+	{
+		return 0.f;
+	}
+	float offset{ (state.gravityProgress + stepFraction * state.gravityPerStep) / g_GravityUnit };
+	return offset < 1.f ? offset : 1.f;
+}
+
+bool ApplyPlacement(GameState& state, const Placement& placement)
+{
+	if (!CanPlace(state, placement))
+	{
+		return false;
+	}
+	state.x = placement.x;
+	state.y = placement.y;
+	state.rotation = placement.rotation;
+	Lock(state);
+	return true;
+}
+
+bool CanPlace(const GameState& state, const Placement& placement)
+{
+	if (!state.isMoving || placement.rotation < 0 || placement.rotation >= g_NrRotations)
+	{
+		return false;
+	}
+	// Placements can come from a file, so out of the board is checked as well as resting on something
+	const PieceMask& piece{ GetPieceMask(state.figure, placement.rotation) };
+	return !Collides(state.board, piece, placement.x, placement.y) && Collides(state.board, piece, placement.x, placement.y - 1);
+}
+
+void AddGarbage(GameState& state, int nrLines, int hole)
+{
+	if (state.isMoving || state.isGameOver || nrLines <= 0)
+	{
+		return;
+	}
+	if (!InsertGarbageRows(state.board, nrLines, hole, g_GarbageBlock))
+	{
+		state.isGameOver = true;
+	}
+}
+
+void ApplyInput(GameState& state, uint8_t input)
+{
+	if (!state.isMoving || state.isGameOver)
+	{
+		return;
+	}
+
+	if (input & InputRotateCW)
+	{
+		RotatePiece(state.board, state.figure, 0, state.x, state.y, state.rotation);
+	}
+	if (input & InputRotateCCW)
+	{
+		RotatePiece(state.board, state.figure, 1, state.x, state.y, state.rotation);
+	}
+
+	const PieceMask& piece{ GetPieceMask(state.figure, state.rotation) };
+	if ((input & InputLeft) && !Collides(state.board, piece, state.x - 1, state.y))
+	{
+		state.x--;
+	}
+	if ((input & InputRight) && !Collides(state.board, piece, state.x + 1, state.y))
+	{
+		state.x++;
+	}
+
+	if (input & InputHardDrop)
+	{
+		while (!Collides(state.board, piece, state.x, state.y - 1))
+		{
+			state.y--;
+		}
+		Lock(state);
+	}
+}
+
+void Drop(GameState& state)
+{
+	const PieceMask& piece{ GetPieceMask(state.figure, state.rotation) };
+	if (!Collides(state.board, piece, state.x, state.y - 1))
+	{
+		state.y--;
+	}
+	else
+	{
+		Lock(state);
+	}
+}
+
+void Lock(GameState& state)
+{
+	const PieceMask& piece{ GetPieceMask(state.figure, state.rotation) };
+	LockPiece(state.board, piece, state.x, state.y, state.figure);
+	int nrCleared{ ClearFullRows(state.board, state.y + piece.bottom, piece.height) };
+	state.lines += nrCleared;
+	if (nrCleared > 0)
+	{
+		state.clears[nrCleared - 1]++;
+	}
+	state.score += g_LineScores[nrCleared];
+	state.isMoving = false;
+}
+
+void Spawn(GameState& state)
+{
+	state.figure = state.queue[0];
+	for (int i = 1; i < g_QueueLength; i++)
+	{
+		state.queue[i - 1] = state.queue[i];
+	}
+	state.queue[g_QueueLength - 1] = uint8_t(NextPiece(state.bag));
+	state.blocksUsed++;
+
+	state.x = g_SpawnX;
+	state.y = g_PieceTables.spawnY[state.figure];
+	state.rotation = 0;
+
+	const PieceMask& piece{ GetPieceMask(state.figure, state.rotation) };
+	if (Collides(state.board, piece, state.x, state.y))
+	{
+		state.isGameOver = true;
+		return;
+	}
+	state.isMoving = true;
+}
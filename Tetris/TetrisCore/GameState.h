@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include "Tetromino.h"
+#include "Random.h"
+
+// The simulation always advances in fixed steps, gravity is counted in 1/65536th of a cell per step
+const int g_StepsPerSecond{ 60 };
+const uint32_t g_GravityUnit{ 1 << 16 };
+const float g_DefaultGravity{ 6.f }; // cells per second
+const int g_QueueLength{ 6 }; // the next piece and the previews after it
+
+// Actions the player takes during one step, combined as bit flags
+enum InputFlags : uint8_t
+{
+	InputNone = 0,
+	InputLeft = 1 << 0,
+	InputRight = 1 << 1,
+	InputRotateCW = 1 << 2,
+	InputRotateCCW = 1 << 3,
+	InputHardDrop = 1 << 4
+};
+
+// Points for clearing 0 to 4 lines with one piece
+const int g_LineScores[5]{ 0, 100, 300, 500, 800 };
+
+// Everything needed to play one game, no window or renderer involved.
+// All randomness comes from the bag, so a game is fully reproduced by its seed and inputs.
+struct GameState
+{
+	Board board;
+	int x, y;
+	int figure;
+	int rotation;
+	bool isMoving;
+	bool isGameOver;
+	int counter;
+	int blocksUsed;
+	int lines;
+	int clears[4]; // pieces that cleared 1 to 4 lines at once
+	int score;
+	uint32_t gravityPerStep;
+	uint32_t gravityProgress;
+	uint64_t seed;
+	PieceBag bag;
+	uint8_t queue[g_QueueLength];
+};
+
+// Where a piece ends up: the position of its rotation point and its rotation
+struct Placement
+{
+	int x, y;
+	int rotation;
+};
+
+void NewGame(GameState& state, uint64_t seed, float gravity = g_DefaultGravity);
+// Moves the moving piece right away without advancing time, so a key press shows in the frame it came in
+void ApplyInput(GameState& state, uint8_t input);
+// The same as ApplyInput followed by a step without input
+void Step(GameState& state, uint8_t input);
+int StepsUntilDrop(const GameState& state);
+void SkipSteps(GameState& state, int nrSteps);
+float GetFallOffset(const GameState& state, float stepFraction);
+// Locks the moving piece at the placement right away, for players that search placements instead of pressing keys.
+// Returns false and leaves the state alone when CanPlace doesn't allow it.
+bool ApplyPlacement(GameState& state, const Placement& placement);
+// Whether there is a moving piece that fits at the placement and couldn't fall any further from there
+bool CanPlace(const GameState& state, const Placement& placement);
+// Pushes rows sent by an opponent under the stack, only between two pieces. Pushing cells out of the top ends the game.
+void AddGarbage(GameState& state, int nrLines, int hole);
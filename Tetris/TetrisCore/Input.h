@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include "GameState.h"
+
+// Auto-repeat of a held left or right key, counted in simulation steps instead of OS key repeats, so it repeats
+// the same at any frame rate and the moves it makes are recorded like any other input.
+// The press itself moves once, holding on moves again after g_DasSteps and then every g_ArrSteps.
+// With both keys down the one pressed last repeats.
+const int g_DasSteps{ 10 }; // delayed auto shift, 167 ms
+const int g_ArrSteps{ 2 }; // auto repeat rate, 33 ms
+
+struct AutoRepeat
+{
+	uint8_t held; // InputLeft and InputRight of the keys that are down
+	uint8_t direction; // the one that repeats, InputNone when neither is down
+	int heldSteps;
+};
+
+inline void PressDirection(AutoRepeat& repeat, uint8_t direction)
+{
+	repeat.held |= direction;
+	repeat.direction = direction;
+	repeat.heldSteps = 0;
+}
+
+inline void ReleaseDirection(AutoRepeat& repeat, uint8_t direction)
+{
+	repeat.held &= ~direction;
+	if (repeat.direction == direction)
+	{
+		// The other key takes over when it is still down, with a new delay
+		repeat.direction = repeat.held;
+		repeat.heldSteps = 0;
+	}
+}
+
+// Once per step, returns the input to apply in that step
+inline uint8_t StepAutoRepeat(AutoRepeat& repeat)
+{
+	if (repeat.direction == InputNone)
+	{
+		return InputNone;
+	}
+	repeat.heldSteps++;
+	bool isRepeating{ repeat.heldSteps >= g_DasSteps && (repeat.heldSteps - g_DasSteps) % g_ArrSteps == 0 };
+	return isRepeating ? repeat.direction : uint8_t(InputNone);
+}
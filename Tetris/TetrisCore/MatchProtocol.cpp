@@ -0,0 +1,144 @@
+#include "MatchProtocol.h"
+
+size_t StartMessage(std::vector<uint8_t>& out, MessageType type)
+{
+	size_t start{ out.size() };
+	Put(out, uint32_t{});
+	Put(out, type);
+	return start;
+}
+
+void EndMessage(std::vector<uint8_t>& out, size_t start)
+{
+	uint32_t size{ uint32_t(out.size() - start - g_MessageHeaderSize) };
+	std::memcpy(&out[start], &size, sizeof(size));
+}
+
+bool PeekMessage(const uint8_t* pBytes, size_t nrBytes, bool& isComplete, MessageType& type, MessageReader& payload, size_t& size)
+{
+	isComplete = false;
+	if (nrBytes < size_t(g_MessageHeaderSize))
+	{
+		return true;
+	}
+	uint32_t payloadSize{};
+	std::memcpy(&payloadSize, pBytes, sizeof(payloadSize));
+	type = MessageType(pBytes[4]);
+	if (payloadSize > g_MaxPayload || type < MessageType::NewGames || type > MessageType::Deltas)
+	{
+		return false;
+	}
+	size = g_MessageHeaderSize + size_t(payloadSize);
+	if (nrBytes < size)
+	{
+		return true;
+	}
+	isComplete = true;
+	payload = MessageReader{ pBytes + g_MessageHeaderSize, pBytes + size };
+	return true;
+}
+
+void TakeSnapshot(GameSnapshot& snapshot, const GameState& state)
+{
+	for (int i = 0; i < g_BoardRows; i++)
+	{
+		snapshot.rows[i] = state.board.filled[i];
+	}
+	snapshot.piece = uint8_t(state.figure | state.rotation << 3 | (state.isMoving ? g_PieceMoving : 0) | (state.isGameOver ? g_PieceGameOver : 0));
+	snapshot.x = int8_t(state.x);
+	snapshot.y = int8_t(state.y);
+	snapshot.score = uint32_t(state.score);
+	snapshot.lines = uint32_t(state.lines);
+}
+
+bool IsSameSnapshot(const GameSnapshot& a, const GameSnapshot& b)
+{
+	for (int i = 0; i < g_BoardRows; i++)
+	{
+		if (a.rows[i] != b.rows[i])
+		{
+			return false;
+		}
+	}
+	return a.piece == b.piece && a.x == b.x && a.y == b.y && a.score == b.score && a.lines == b.lines;
+}
+
+void PutDelta(std::vector<uint8_t>& out, uint16_t game, const GameState& state, GameSnapshot& sent)
+{
+	GameSnapshot now;
+	TakeSnapshot(now, state);
+	uint32_t rowMask{};
+	for (int i = 0; i < g_BoardRows; i++)
+	{
+		rowMask |= uint32_t(now.rows[i] != sent.rows[i]) << i;
+	}
+	uint8_t flags{};
+	flags |= now.piece != sent.piece || now.x != sent.x || now.y != sent.y ? DeltaPiece : 0;
+	flags |= rowMask != 0 ? DeltaRows : 0;
+	flags |= now.score != sent.score || now.lines != sent.lines ? DeltaScore : 0;
+	if (flags == 0)
+	{
+		return;
+	}
+
+	Put(out, game);
+	Put(out, flags);
+	if (flags & DeltaPiece)
+	{
+		Put(out, now.piece);
+		Put(out, now.x);
+		Put(out, now.y);
+	}
+	if (flags & DeltaRows)
+	{
+		Put(out, rowMask);
+		for (int i = 0; i < g_BoardRows; i++)
+		{
+			if (rowMask & (1u << i))
+			{
+				Put(out, now.rows[i]);
+			}
+		}
+	}
+	if (flags & DeltaScore)
+	{
+		Put(out, now.score);
+		Put(out, now.lines);
+	}
+	sent = now;
+}
+
+bool TakeDelta(MessageReader& reader, std::vector<GameSnapshot>& games)
+{
+	uint16_t game{};
+	uint8_t flags{};
+	if (!Take(reader, game) || !Take(reader, flags) || game >= games.size())
+	{
+		return false;
+	}
+	GameSnapshot& snapshot{ games[game] };
+	if ((flags & DeltaPiece) && !(Take(reader, snapshot.piece) && Take(reader, snapshot.x) && Take(reader, snapshot.y)))
+	{
+		return false;
+	}
+	if (flags & DeltaRows)
+	{
+		uint32_t rowMask{};
+		if (!Take(reader, rowMask))
+		{
+			return false;
+		}
+		for (int i = 0; i < g_BoardRows; i++)
+		{
+			if ((rowMask & (1u << i)) && !Take(reader, snapshot.rows[i]))
+			{
+				return false;
+			}
+		}
+	}
+	if ((flags & DeltaScore) && !(Take(reader, snapshot.score) && Take(reader, snapshot.lines)))
+	{
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "GameState.h"
+
+// Messages between the match server and its clients. Every message is its payload size as a uint32_t and a type byte,
+// then the payload, numbers as they are in memory like the replay and corpus files. A client plays many games over
+// one connection and names them by a uint16_t index, the payloads are lists of entries up to the end of the message:
+//   NewGames  client to server, per game the index and the uint64_t seed, the game starts over with that seed
+//   Tick      client to server, the uint32_t tick and per game with input the index and the input flags.
+//             The server steps every game of the connection once, the ones not listed without input.
+//   Deltas    server to client, the tick it answers and per game that changed in it the index and a delta
+// A delta is a flags byte, then the piece when DeltaPiece is set, a row mask and the bits of every row in it when
+// DeltaRows is set and the score and lines when DeltaScore is set. A game that didn't change costs nothing,
+// a step that only moves the piece 6 bytes, where the whole board would be 160 cells.
+enum class MessageType : uint8_t
+{
+	NewGames = 1,
+	Tick = 2,
+	Deltas = 3
+};
+
+const uint16_t g_DefaultPort{ 7777 };
+const int g_MessageHeaderSize{ 5 };
+const uint32_t g_MaxPayload{ 1 << 24 };
+const int g_MaxGamesPerConnection{ 1 << 16 };
+
+enum DeltaFlags : uint8_t
+{
+	DeltaPiece = 1 << 0, // piece byte, x and y as signed bytes
+	DeltaRows = 1 << 1, // uint32_t mask of the rows that changed, then their bits from the bottom up
+	DeltaScore = 1 << 2 // score and lines as uint32_t
+};
+static_assert(g_BoardRows <= 32, "the changed rows are sent as a 32 bit mask");
+
+// What one side knows of a game: the server keeps what it sent last, a client builds it up from the deltas
+struct GameSnapshot
+{
+	Board::Bits rows[g_BoardRows];
+	uint8_t piece; // figure, rotation << 3, isMoving << 5 and isGameOver << 6
+	int8_t x, y;
+	uint32_t score;
+	uint32_t lines;
+};
+
+const uint8_t g_PieceMoving{ 1 << 5 };
+const uint8_t g_PieceGameOver{ 1 << 6 };
+
+// Reads a payload front to back, every Take fails once the payload runs out
+struct MessageReader
+{
+	const uint8_t* p;
+	const uint8_t* pEnd;
+};
+
+template<typename T>
+inline void Put(std::vector<uint8_t>& out, T value)
+{
+	size_t size{ out.size() };
+	out.resize(size + sizeof(T));
+	std::memcpy(&out[size], &value, sizeof(T));
+}
+
+template<typename T>
+inline bool Take(MessageReader& reader, T& value)
+{
+	if (size_t(reader.pEnd - reader.p) < sizeof(T))
+	{
+		return false;
+	}
+	std::memcpy(&value, reader.p, sizeof(T));
+	reader.p += sizeof(T);
+	return true;
+}
+
+inline bool IsDone(const MessageReader& reader)
+{
+	return reader.p == reader.pEnd;
+}
+
+// Returns where the message starts, its entries are put after it and EndMessage fills in the size
+size_t StartMessage(std::vector<uint8_t>& out, MessageType type);
+void EndMessage(std::vector<uint8_t>& out, size_t start);
+// Whether a whole message is at the front of the bytes, then its type, payload and size including the header.
+// Fails on a payload over g_MaxPayload or an unknown type, after which the stream can't be read anymore.
+bool PeekMessage(const uint8_t* pBytes, size_t nrBytes, bool& isComplete, MessageType& type, MessageReader& payload, size_t& size);
+
+inline void PutNewGame(std::vector<uint8_t>& out, uint16_t game, uint64_t seed)
+{
+	Put(out, game);
+	Put(out, seed);
+}
+
+inline void PutInput(std::vector<uint8_t>& out, uint16_t game, uint8_t input)
+{
+	Put(out, game);
+	Put(out, input);
+}
+
+void TakeSnapshot(GameSnapshot& snapshot, const GameState& state);
+bool IsSameSnapshot(const GameSnapshot& a, const GameSnapshot& b);
+// Puts the delta from what was sent to the state and makes that what was sent, puts nothing when nothing changed
+void PutDelta(std::vector<uint8_t>& out, uint16_t game, const GameState& state, GameSnapshot& sent);
+// Applies one delta entry to the game it names, fails on a truncated entry or a game that isn't there
+bool TakeDelta(MessageReader& reader, std::vector<GameSnapshot>& games);
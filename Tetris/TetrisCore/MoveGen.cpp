@@ -0,0 +1,283 @@
+#include "MoveGen.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The search works on whole rows of positions at once. For every rotation and y there is one word with a bit
+// per x, bit x + g_XOffset, telling where the piece fits and where it can get to. Shifting, soft dropping
+// and kicking then move all positions in a row with a few shifts and ands.
+const int g_XOffset{ 4 };
+const int g_YOffset{ 4 };
+const int g_NrYs{ 32 };
+
+// Pieces where a different rotation covers the same cells are searched separately but listed once,
+// under the lowest rotation with those cells. dx and dy move a position to that rotation.
+struct SameCells
+{
+	int rotation;
+	int dx, dy;
+};
+
+struct SameCellsTable
+{
+	SameCells rotations[g_NrBlockTypes][g_NrRotations];
+};
+
+constexpr bool HaveSameRows(const PieceMask& a, const PieceMask& b)
+{
+	if (a.width != b.width || a.height != b.height)
+	{
+		return false;
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		if (a.rows[i] != b.rows[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+constexpr SameCellsTable MakeSameCellsTable()
+{
+	SameCellsTable table{};
+	for (int type = 0; type < g_NrBlockTypes; type++)
+	{
+		for (int rotation = 0; rotation < g_NrRotations; rotation++)
+		{
+			const PieceMask& mask{ g_PieceTables.masks[type][rotation] };
+			int same{ 0 };
+			while (!HaveSameRows(g_PieceTables.masks[type][same], mask))
+			{
+				same++;
+			}
+			const PieceMask& sameMask{ g_PieceTables.masks[type][same] };
+			table.rotations[type][rotation] = SameCells{ same, mask.left - sameMask.left, mask.bottom - sameMask.bottom };
+		}
+	}
+	return table;
+}
+
+constexpr SameCellsTable g_SameCells{ MakeSameCellsTable() };
+
+inline int LowestBit(uint32_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index{};
+	_BitScanForward(&index, bits);
+	return int(index);
+#else
+	return __builtin_ctz(bits);
+#endif
+}
+
+// Moves positions dx to the right, without a branch on the sign since kicks never move more than 2
+inline uint32_t ShiftPositions(uint32_t positions, int dx)
+{
+	return (positions << (dx + 2)) >> 2;
+}
+
+// Every position reachable from the reached ones by shifting along the row: both directions are
+// filled in log steps, each step doubling how far positions travel through fitting positions
+inline uint32_t SpreadInRow(uint32_t reached, uint32_t fits)
+{
+	uint32_t up{ reached }, down{ reached };
+	uint32_t upFits{ fits }, downFits{ fits };
+	for (int shift = 1; shift < 16; shift *= 2)
+	{
+		up |= (up << shift) & upFits;
+		upFits &= upFits << shift;
+		down |= (down >> shift) & downFits;
+		downFits &= downFits >> shift;
+	}
+	return up | down;
+}
+
+// Everything the search needs for one rotation of the piece. Rows the piece can't be in stay 0,
+// so drops and kicks past the floor or the ceiling just find nothing that fits.
+struct RotationRows
+{
+	uint32_t fits[g_NrYs];
+	uint32_t reached[g_NrYs];
+	int minY, maxY;
+};
+
+void FindFits(const Board& board, int blockType, int rotation, RotationRows& rows)
+{
+	const PieceMask& piece{ GetPieceMask(blockType, rotation) };
+	rows.minY = -piece.bottom;
+	rows.maxY = g_BoardRows - piece.bottom - piece.height;
+
+	// Positions where the piece is inside the walls
+	int minX{ -piece.left };
+	int maxX{ g_BoardWidth - piece.width - piece.left };
+	uint32_t inside{ ((uint32_t(1) << (maxX - minX + 1)) - 1) << (minX + g_XOffset) };
+
+	for (int i = 0; i < g_NrYs; i++)
+	{
+		rows.fits[i] = 0;
+		rows.reached[i] = 0;
+	}
+
+	// Only rows where the piece overlaps the stack can block it
+	int stackY{ board.height - piece.bottom };
+	stackY = stackY < rows.maxY + 1 ? stackY : rows.maxY + 1;
+	for (int y = rows.minY; y < stackY; y++)
+	{
+		// A filled cell at column c blocks x = c - cell.x, which is bit c + g_XOffset - cell.x
+		uint32_t blocked{};
+		for (const PieceCell& cell : piece.cells)
+		{
+			blocked |= uint32_t(board.filled[y + cell.y]) << (g_XOffset - cell.x);
+		}
+		rows.fits[y + g_YOffset] = inside & ~blocked;
+	}
+	for (int y = stackY < rows.minY ? rows.minY : stackY; y <= rows.maxY; y++)
+	{
+		rows.fits[y + g_YOffset] = inside;
+	}
+}
+
+void GeneratePlacements(const Board& board, int blockType, int x, int y, int rotation, PlacementList& list)
+{
+	list.count = 0;
+	if (Collides(board, GetPieceMask(blockType, rotation), x, y))
+	{
+		return;
+	}
+
+	RotationRows rows[g_NrRotations];
+	for (int i = 0; i < g_NrRotations; i++)
+	{
+		FindFits(board, blockType, i, rows[i]);
+	}
+
+	// When every rotation fits at the start row without touching the stack, the piece can turn and shift
+	// anywhere there and fall freely, so each rotation reaches every x at its lowest row above the stack.
+	// Sweeping all those empty rows is skipped that way, otherwise the search starts from the piece itself.
+	bool isAboveStack{ true };
+	for (int i = 0; i < g_NrRotations; i++)
+	{
+		if (y < rows[i].minY || y > rows[i].maxY || y + GetPieceMask(blockType, i).bottom < board.height)
+		{
+			isAboveStack = false;
+		}
+	}
+
+	// Rows whose reached positions changed since they were last spread, one bit per y + g_YOffset.
+	// The highest changed row is always handled first, dropping only adds rows below it
+	// and only kicks that move the piece up send the search back up.
+	uint32_t changed[g_NrRotations]{};
+	if (isAboveStack)
+	{
+		for (int i = 0; i < g_NrRotations; i++)
+		{
+			int freeY{ board.height - GetPieceMask(blockType, i).bottom };
+			freeY = freeY < rows[i].minY ? rows[i].minY : freeY;
+			rows[i].reached[freeY + g_YOffset] = rows[i].fits[freeY + g_YOffset];
+			changed[i] = uint32_t(1) << (freeY + g_YOffset);
+		}
+	}
+	else
+	{
+		rows[rotation].reached[y + g_YOffset] = uint32_t(1) << (x + g_XOffset);
+		changed[rotation] = uint32_t(1) << (y + g_YOffset);
+	}
+
+	int row{ g_NrYs - 1 };
+	while (row >= 0)
+	{
+		uint32_t anyChanged{ changed[0] | changed[1] | changed[2] | changed[3] };
+		if (anyChanged == 0)
+		{
+			break;
+		}
+		if (((anyChanged >> row) & 1) == 0)
+		{
+			row--;
+			continue;
+		}
+
+		int upRow{ row };
+		for (int i = 0; i < g_NrRotations; i++)
+		{
+			if (((changed[i] >> row) & 1) == 0)
+			{
+				continue;
+			}
+			changed[i] &= ~(uint32_t(1) << row);
+			RotationRows& current{ rows[i] };
+			uint32_t reached{ SpreadInRow(current.reached[row], current.fits[row]) };
+			current.reached[row] = reached;
+
+			uint32_t dropped{ reached & current.fits[row - 1] & ~current.reached[row - 1] };
+			current.reached[row - 1] |= dropped;
+			changed[i] |= (dropped != 0 ? uint32_t(1) : 0) << (row - 1);
+
+			for (int turn = 0; turn < 2; turn++)
+			{
+				int next{ (i + (turn == 0 ? 1 : g_NrRotations - 1)) % g_NrRotations };
+				RotationRows& turned{ rows[next] };
+				const PieceCell* kicks{ g_PieceTables.kicks[blockType][i][turn] };
+				// Each position takes the first kick that fits, later kicks only see the ones left over
+				uint32_t left{ reached };
+				for (int k = 0; k < g_NrKicks && left != 0; k++)
+				{
+					int kickRow{ row + kicks[k].y };
+					uint32_t kickFits{ ShiftPositions(turned.fits[kickRow], -kicks[k].x) };
+					uint32_t kicked{ left & kickFits };
+					left &= ~kickFits;
+
+					uint32_t added{ ShiftPositions(kicked, kicks[k].x) & ~turned.reached[kickRow] };
+					if (added != 0)
+					{
+						turned.reached[kickRow] |= added;
+						changed[next] |= uint32_t(1) << kickRow;
+						upRow = kickRow > upRow ? kickRow : upRow;
+					}
+				}
+			}
+		}
+		row = upRow;
+	}
+
+	// A reached position is final when the piece can't go one lower, which needs the stack or the floor
+	// right below it. Rotations covering the same cells are merged into the lowest one first.
+	uint32_t landed[g_NrRotations][g_NrYs];
+	int landedTop{ board.height + g_YOffset + 2 };
+	landedTop = landedTop < g_NrYs ? landedTop : g_NrYs - 1;
+	for (int i = 0; i < g_NrRotations; i++)
+	{
+		for (int row = 0; row <= landedTop; row++)
+		{
+			landed[i][row] = 0;
+		}
+	}
+	for (int i = 0; i < g_NrRotations; i++)
+	{
+		const SameCells& same{ g_SameCells.rotations[blockType][i] };
+		int lastY{ board.height - GetPieceMask(blockType, i).bottom };
+		lastY = lastY < rows[i].maxY ? lastY : rows[i].maxY;
+		uint32_t below{};
+		for (int row = rows[i].minY; row <= lastY; row++)
+		{
+			uint32_t final{ rows[i].reached[row + g_YOffset] & ~below };
+			landed[same.rotation][row + same.dy + g_YOffset] |= ShiftPositions(final, same.dx);
+			below = rows[i].fits[row + g_YOffset];
+		}
+	}
+
+	for (int i = 0; i < g_NrRotations; i++)
+	{
+		for (int row = 0; row <= landedTop; row++)
+		{
+			uint32_t positions{ landed[i][row] };
+			while (positions != 0 && list.count < g_MaxPlacements)
+			{
+				list.placements[list.count++] = Placement{ LowestBit(positions) - g_XOffset, row - g_YOffset, i };
+				positions &= positions - 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include "GameState.h"
+
+// Every final placement a piece can reach from where it is by shifting, rotating with kicks and soft dropping
+// one row at a time, so tucks under overhangs and spins are found too.
+// Rotations that cover the same cells, like the two flat ones of the line, are listed once.
+const int g_MaxPlacements{ 256 };
+
+struct PlacementList
+{
+	Placement placements[g_MaxPlacements];
+	int count;
+};
+
+void GeneratePlacements(const Board& board, int blockType, int x, int y, int rotation, PlacementList& list);
+
+inline void GeneratePlacements(const GameState& state, PlacementList& list)
+{
+	GeneratePlacements(state.board, state.figure, state.x, state.y, state.rotation, list);
+}
@@ -0,0 +1,206 @@
+#include "Policy.h"
+#include <climits>
+#include <cstring>
+
+// The weights the greedy player was tuned with, it doesn't look at wells or transitions
+const EvalWeights g_GreedyWeights{ -0.51f, -0.36f, -0.18f, 0.f, 0.f, 0.f, 0.76f };
+
+Placement ChooseRandom(Policy& policy, const GameState& state);
+Placement ChooseGreedy(const GameState& state);
+float EvaluatePlacement(const Board& board, const PieceMask& piece, int x, int y);
+
+bool ParsePolicyType(const char* pName, PolicyType& type)
+{
+	if (strcmp(pName, "random") == 0)
+	{
+		type = PolicyType::Random;
+		return true;
+	}
+	if (strcmp(pName, "greedy") == 0)
+	{
+		type = PolicyType::Greedy;
+		return true;
+	}
+	if (strcmp(pName, "beam") == 0)
+	{
+		type = PolicyType::Beam;
+		return true;
+	}
+	return false;
+}
+
+void ResetPolicy(Policy& policy, PolicyType type, uint64_t seed)
+{
+	policy.type = type;
+	// Not the game seed itself, so the choices don't follow the piece order
+	SeedRandom(policy.random, ~seed);
+	policy.target = Placement{};
+	policy.targetBlock = -1;
+	policy.lastX = INT_MIN;
+	policy.lastRotation = -1;
+	if (type == PolicyType::Beam && policy.pSearch->arenas.empty())
+	{
+		InitBeamSearch(*policy.pSearch, g_DefaultSearch);
+	}
+}
+
+Placement ChoosePlacement(Policy& policy, const GameState& state)
+{
+	switch (policy.type)
+	{
+	case PolicyType::Greedy:
+		return ChooseGreedy(state);
+	case PolicyType::Beam:
+		return FindBestPlacement(*policy.pSearch, state);
+	default:
+		return ChooseRandom(policy, state);
+	}
+}
+
+uint8_t PlacementInput(Policy& policy, const GameState& state)
+{
+	if (!state.isMoving)
+	{
+		return InputNone;
+	}
+
+	if (policy.targetBlock != state.blocksUsed)
+	{
+		policy.target = ChoosePlacement(policy, state);
+		policy.targetBlock = state.blocksUsed;
+	}
+	else if (state.x == policy.lastX && state.rotation == policy.lastRotation)
+	{
+		// The last input didn't change anything, the target can't be reached so drop where the piece is
+		return InputHardDrop;
+	}
+	policy.lastX = state.x;
+	policy.lastRotation = state.rotation;
+
+	uint8_t input{ InputNone };
+	int turns{ (policy.target.rotation - state.rotation + g_NrRotations) % g_NrRotations };
+	if (turns == 3)
+	{
+		input |= InputRotateCCW;
+	}
+	else if (turns != 0)
+	{
+		input |= InputRotateCW;
+	}
+	else if (state.x < policy.target.x)
+	{
+		input |= InputRight;
+	}
+	else if (state.x > policy.target.x)
+	{
+		input |= InputLeft;
+	}
+	else
+	{
+		input |= InputHardDrop;
+	}
+	return input;
+}
+
+void PlayGame(GameState& state, Policy& policy, int maxPieces, Replay* pReplay)
+{
+	if (pReplay)
+	{
+		StartRecording(*pReplay, state);
+	}
+	while (!state.isGameOver)
+	{
+		if (!state.isMoving)
+		{
+			if (state.blocksUsed >= maxPieces)
+			{
+				break;
+			}
+			// Nothing happens until the next piece spawns, and without gravity it never does
+			int nrIdle{ StepsUntilDrop(state) };
+			if (nrIdle == INT_MAX)
+			{
+				break;
+			}
+			SkipSteps(state, nrIdle);
+		}
+		if (policy.type == PolicyType::Beam && state.isMoving)
+		{
+			// The search leaves the piece where it is when it finds nowhere to put it, that isn't a placement
+			Placement placement{ ChoosePlacement(policy, state) };
+			if (CanPlace(state, placement))
+			{
+				if (pReplay)
+				{
+					RecordPlacement(*pReplay, state, placement);
+				}
+				ApplyPlacement(state, placement);
+			}
+			else
+			{
+				policy.nrFallbacks++;
+				Step(state, InputNone);
+			}
+		}
+		else
+		{
+			uint8_t input{ PlacementInput(policy, state) };
+			if (pReplay)
+			{
+				RecordInput(*pReplay, state, input);
+			}
+			Step(state, input);
+		}
+	}
+	if (pReplay)
+	{
+		FinishRecording(*pReplay, state);
+	}
+}
+
+Placement ChooseRandom(Policy& policy, const GameState& state)
+{
+	int rotation{ int(RandomBelow(policy.random, g_NrRotations)) };
+	const PieceMask& piece{ GetPieceMask(state.figure, rotation) };
+	int minX{ -piece.left };
+	int maxX{ g_BoardWidth - piece.width - piece.left };
+	return Placement{ minX + int(RandomBelow(policy.random, uint32_t(maxX - minX + 1))), state.y, rotation };
+}
+
+Placement ChooseGreedy(const GameState& state)
+{
+	// Tries every rotation and column from the current height and keeps the best resulting board
+	Placement best{ state.x, state.y, state.rotation };
+	float bestScore{ -1e30f };
+	for (int rotation = 0; rotation < g_NrRotations; rotation++)
+	{
+		const PieceMask& piece{ GetPieceMask(state.figure, rotation) };
+		for (int x = -piece.left; x + piece.left + piece.width <= g_BoardWidth; x++)
+		{
+			int y{ state.y };
+			if (Collides(state.board, piece, x, y))
+			{
+				continue;
+			}
+			while (!Collides(state.board, piece, x, y - 1))
+			{
+				y--;
+			}
+
+			float score{ EvaluatePlacement(state.board, piece, x, y) };
+			if (score > bestScore)
+			{
+				bestScore = score;
+				best = Placement{ x, y, rotation };
+			}
+		}
+	}
+	return best;
+}
+
+float EvaluatePlacement(const Board& board, const PieceMask& piece, int x, int y)
+{
+	LockedRows locked;
+	LockIntoRows(board.filled, board.height, piece, x, y, locked);
+	return EvaluateBoard(GetBoardFeatures(locked.rows, locked.nrRows), g_GreedyWeights) + g_GreedyWeights.lines * locked.nrCleared;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include "GameState.h"
+#include "BeamSearch.h"
+#include "Replay.h"
+
+// Computer players for offline evaluation. A policy picks where the current piece should go,
+// PlacementInput then turns that choice into the input for one step.
+// The beam search finds tucks and spins that the per-step input can't play, PlayGame puts its pieces directly.
+// A policy only remembers the game it plays, the search it uses can serve every policy of its thread.
+enum class PolicyType
+{
+	Random, Greedy, Beam
+};
+
+struct Policy
+{
+	PolicyType type;
+	Random random;
+	Placement target;
+	int targetBlock; // blocksUsed the target was chosen for
+	int lastX, lastRotation;
+	BeamSearch* pSearch; // of the beam player, not owned
+	int nrFallbacks; // placements chosen that couldn't be played, the piece was left to gravity. Not reset with the policy.
+};
+
+bool ParsePolicyType(const char* pName, PolicyType& type);
+// A beam player's search is started with the default settings if it wasn't yet
+void ResetPolicy(Policy& policy, PolicyType type, uint64_t seed);
+Placement ChoosePlacement(Policy& policy, const GameState& state);
+uint8_t PlacementInput(Policy& policy, const GameState& state);
+
+// Plays one game with the policy until it is over or maxPieces pieces were used, recording it when pReplay is given
+void PlayGame(GameState& state, Policy& policy, int maxPieces, Replay* pReplay = nullptr);
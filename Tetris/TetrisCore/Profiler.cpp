@@ -0,0 +1,163 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+
+bool g_IsProfiling{ false };
+int g_ZoneDepth{};
+
+ProfileFrame g_Frames[g_FrameHistory]{};
+int g_NextFrame{}; // the oldest frame, overwritten next
+ProfileFrame g_CurrentFrame{};
+const char* g_SlotNames[g_FrameSlots]{};
+uint64_t g_ProfileStart{};
+uint64_t g_FrameStart{};
+const char* g_pTracePath{ nullptr };
+std::vector<ProfileZone> g_TraceZones{};
+uint64_t g_DroppedZones{};
+
+bool WriteTrace(const char* path);
+
+void StartProfiler(const char* pTracePath)
+{
+	for (ProfileFrame& frame : g_Frames)
+	{
+		frame = ProfileFrame{};
+	}
+	g_NextFrame = 0;
+	g_CurrentFrame = ProfileFrame{};
+	g_pTracePath = pTracePath;
+	g_TraceZones.clear();
+	g_DroppedZones = 0;
+	g_ProfileStart = GetProfileTime();
+	g_FrameStart = g_ProfileStart;
+	g_IsProfiling = true;
+}
+
+bool StopProfiler()
+{
+	if (!g_IsProfiling)
+	{
+		return true;
+	}
+	g_IsProfiling = false;
+	bool isWritten{ g_pTracePath == nullptr || WriteTrace(g_pTracePath) };
+	g_pTracePath = nullptr;
+	g_TraceZones.clear();
+	g_TraceZones.shrink_to_fit();
+	return isWritten;
+}
+
+bool IsCapturingTrace()
+{
+	return g_IsProfiling && g_pTracePath != nullptr;
+}
+
+void EndProfileFrame()
+{
+	if (!g_IsProfiling)
+	{
+		return;
+	}
+	uint64_t now{ GetProfileTime() };
+	AddProfileZone("Frame", g_FrameStart, now, -1);
+	g_CurrentFrame.milliseconds = (now - g_FrameStart) / 1e6f;
+	g_Frames[g_NextFrame] = g_CurrentFrame;
+	g_NextFrame = (g_NextFrame + 1) % g_FrameHistory;
+	g_CurrentFrame = ProfileFrame{};
+	g_FrameStart = now;
+}
+
+void AddProfileZone(const char* pName, uint64_t start, uint64_t end, int depth)
+{
+	if (!g_IsProfiling)
+	{
+		return;
+	}
+	if (depth == 0)
+	{
+		// Names are literals, so the same zone always has the same pointer
+		for (int i = 0; i < g_FrameSlots; i++)
+		{
+			if (g_SlotNames[i] == nullptr)
+			{
+				g_SlotNames[i] = pName;
+			}
+			if (g_SlotNames[i] == pName)
+			{
+				g_CurrentFrame.slots[i] += (end - start) / 1e6f;
+				break;
+			}
+		}
+	}
+	if (g_pTracePath)
+	{
+		if (g_TraceZones.size() < g_MaxTraceZones)
+		{
+			g_TraceZones.push_back(ProfileZone{ pName, start - g_ProfileStart, end - start });
+		}
+		else
+		{
+			g_DroppedZones++;
+		}
+	}
+}
+
+const ProfileFrame& GetProfileFrame(int i)
+{
+	return g_Frames[(g_NextFrame + i) % g_FrameHistory];
+}
+
+const char* GetSlotName(int slot)
+{
+	return g_SlotNames[slot];
+}
+
+void GetFrameTimes(FrameTimes& times)
+{
+	times = FrameTimes{};
+	float milliseconds[g_FrameHistory];
+	for (const ProfileFrame& frame : g_Frames)
+	{
+		// Frames that weren't drawn yet are 0
+		if (frame.milliseconds > 0.f)
+		{
+			milliseconds[times.nrFrames++] = frame.milliseconds;
+			int bucket{ std::min(int(frame.milliseconds), g_HistogramBuckets - 1) };
+			times.histogram[bucket]++;
+		}
+	}
+	if (times.nrFrames == 0)
+	{
+		return;
+	}
+	std::sort(milliseconds, milliseconds + times.nrFrames);
+	int last{ times.nrFrames - 1 };
+	times.median = milliseconds[last / 2];
+	times.p95 = milliseconds[last * 95 / 100];
+	times.p99 = milliseconds[last * 99 / 100];
+	times.max = milliseconds[last];
+}
+
+bool WriteTrace(const char* path)
+{
+	FILE* pFile{ fopen(path, "w") };
+	if (!pFile)
+	{
+		return false;
+	}
+	// Complete events in microseconds, nesting follows from the times
+	fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(pFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"game\"}}");
+	for (const ProfileZone& zone : g_TraceZones)
+	{
+		fprintf(pFile, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}", zone.pName,
+			zone.start / 1e3, zone.duration / 1e3);
+	}
+	if (g_DroppedZones > 0)
+	{
+		fprintf(pFile, ",\n{\"name\":\"%llu zones dropped\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":%.3f}",
+			(unsigned long long)g_DroppedZones, g_TraceZones.empty() ? 0.0 : g_TraceZones.back().start / 1e3);
+	}
+	fprintf(pFile, "\n]}\n");
+	return fclose(pFile) == 0;
+}
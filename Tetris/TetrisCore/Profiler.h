@@ -0,0 +1,97 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Scoped zone timers for the frame loop, shown as an overlay of frame times and written as a Chrome trace
+// (chrome://tracing or ui.perfetto.dev). PROFILE_ZONE("Draw") times the rest of the enclosing scope.
+// Built without TETRIS_PROFILE the zones compile to nothing, built with it an idle zone costs one compare.
+// Zones only record while the profiler runs and only on the thread that ends the frames.
+const int g_FrameHistory{ 256 }; // frames kept for the overlay
+const int g_FrameSlots{ 8 }; // outermost zones a frame is split into, later ones are left out
+const int g_HistogramBuckets{ 40 }; // of 1 ms, the last one also counts everything slower
+const size_t g_MaxTraceZones{ 1 << 20 }; // 24 MB, some minutes of frames. Zones after that are dropped.
+
+// One finished zone, times in nanoseconds since the profiler started
+struct ProfileZone
+{
+	const char* pName; // a string literal, only the pointer is kept
+	uint64_t start;
+	uint64_t duration;
+};
+
+// How long the outermost zones took in one frame, in the order they first ran
+struct ProfileFrame
+{
+	float milliseconds;
+	float slots[g_FrameSlots];
+};
+
+struct FrameTimes
+{
+	int nrFrames;
+	float median, p95, p99, max; // milliseconds
+	int histogram[g_HistogramBuckets];
+};
+
+extern bool g_IsProfiling;
+extern int g_ZoneDepth;
+
+// The overlay keeps the last frames, a trace path also keeps every zone until the profiler stops
+void StartProfiler(const char* pTracePath);
+// Writes the trace, returns false when the file can't be written
+bool StopProfiler();
+bool IsCapturingTrace();
+
+// Once per frame, after the swap: the time since the previous call is the frame time
+void EndProfileFrame();
+void AddProfileZone(const char* pName, uint64_t start, uint64_t end, int depth);
+
+// Oldest first, index i of g_FrameHistory
+const ProfileFrame& GetProfileFrame(int i);
+const char* GetSlotName(int slot);
+void GetFrameTimes(FrameTimes& times);
+
+inline uint64_t GetProfileTime()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct ScopedZone
+{
+	const char* pName;
+	uint64_t start;
+	int depth; // -1 when the profiler wasn't running as the zone started
+
+	explicit ScopedZone(const char* pZoneName)
+		: pName{ pZoneName }
+		, start{}
+		, depth{ -1 }
+	{
+		if (g_IsProfiling)
+		{
+			depth = g_ZoneDepth++;
+			start = GetProfileTime();
+		}
+	}
+
+	~ScopedZone()
+	{
+		if (depth >= 0)
+		{
+			g_ZoneDepth--;
+			AddProfileZone(pName, start, GetProfileTime(), depth);
+		}
+	}
+
+	ScopedZone(const ScopedZone&) = delete;
+	ScopedZone& operator=(const ScopedZone&) = delete;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#ifdef TETRIS_PROFILE
+#define PROFILE_ZONE(name) ScopedZone PROFILE_CONCAT(zone, __LINE__){ name }
+#else
+#define PROFILE_ZONE(name)
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include "Tetromino.h"
+
+// xoshiro128** generator: small enough to keep one per game and fast enough to inline everywhere.
+// The same seed always gives the same numbers on every platform.
+struct Random
+{
+	uint32_t state[4];
+};
+
+inline uint32_t RotateLeft(uint32_t value, int shift)
+{
+	return (value << shift) | (value >> (32 - shift));
+}
+
+inline void SeedRandom(Random& random, uint64_t seed)
+{
+	// splitmix64 spreads any seed, 0 included, over the whole state
+	for (int i = 0; i < 4; i += 2)
+	{
+		seed += 0x9E3779B97F4A7C15ull;
+		uint64_t z{ seed };
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+		random.state[i] = uint32_t(z);
+		random.state[i + 1] = uint32_t(z >> 32);
+	}
+}
+
+inline uint32_t NextRandom(Random& random)
+{
+	uint32_t* s{ random.state };
+	uint32_t result{ RotateLeft(s[1] * 5, 7) * 9 };
+	uint32_t t{ s[1] << 9 };
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = RotateLeft(s[3], 11);
+	return result;
+}
+
+// Unbiased number in [0, bound), without a division in the common case
+inline uint32_t RandomBelow(Random& random, uint32_t bound)
+{
+	uint64_t product{ uint64_t(NextRandom(random)) * bound };
+	uint32_t low{ uint32_t(product) };
+	if (low < bound)
+	{
+		uint32_t threshold{ (0u - bound) % bound };
+		while (low < threshold)
+		{
+			product = uint64_t(NextRandom(random)) * bound;
+			low = uint32_t(product);
+		}
+	}
+	return uint32_t(product >> 32);
+}
+
+// 7-bag randomizer: every group of seven pieces holds each block type once, in a shuffled order
+struct PieceBag
+{
+	Random random;
+	uint8_t pieces[g_NrBlockTypes];
+	int next;
+};
+
+inline void SeedBag(PieceBag& bag, uint64_t seed)
+{
+	SeedRandom(bag.random, seed);
+	bag.next = g_NrBlockTypes;
+}
+
+inline int NextPiece(PieceBag& bag)
+{
+	if (bag.next == g_NrBlockTypes)
+	{
+		for (int i = 0; i < g_NrBlockTypes; i++)
+		{
+			bag.pieces[i] = uint8_t(i);
+		}
+		for (int i = g_NrBlockTypes - 1; i > 0; i--)
+		{
+			int j{ int(RandomBelow(bag.random, uint32_t(i + 1))) };
+			uint8_t piece{ bag.pieces[i] };
+			bag.pieces[i] = bag.pieces[j];
+			bag.pieces[j] = piece;
+		}
+		bag.next = 0;
+	}
+	return bag.pieces[bag.next++];
+}
+
+// Pre-generates the next nrPieces pieces, any length
+inline void FillPieceQueue(PieceBag& bag, uint8_t* pQueue, int nrPieces)
+{
+	for (int i = 0; i < nrPieces; i++)
+	{
+		pQueue[i] = uint8_t(NextPiece(bag));
+	}
+}
@@ -0,0 +1,286 @@
+#include "Replay.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+bool IsHeaderPossible(const ReplayHeader& header);
+void AddEvent(Replay& replay, uint32_t step);
+bool ReadVarint(const ReplayView& replay, uint32_t& offset, uint32_t& value);
+bool PeekEvent(const ReplayView& replay, ReplayKeyframe& position, uint32_t& step);
+void ApplyEvent(ReplayKeyframe& position, const ReplayView& replay);
+void SkipIdleSteps(GameState& state, uint32_t nrSteps);
+
+void StartRecording(Replay& replay, const GameState& state)
+{
+	replay.header = ReplayHeader{};
+	memcpy(replay.header.magic, g_ReplayMagic, sizeof(g_ReplayMagic));
+	replay.header.version = g_ReplayVersion;
+	replay.header.seed = state.seed;
+	replay.header.gravityPerStep = state.gravityPerStep;
+	replay.events.clear();
+	replay.lastStep = state.counter;
+}
+
+void RecordInput(Replay& replay, const GameState& state, uint8_t input)
+{
+	// Input only does something to a moving piece
+	if (input == InputNone || !state.isMoving)
+	{
+		return;
+	}
+	AddEvent(replay, state.counter);
+	replay.events.push_back(input);
+}
+
+void RecordPlacement(Replay& replay, const GameState& state, const Placement& placement)
+{
+	if (!state.isMoving)
+	{
+		return;
+	}
+	AddEvent(replay, state.counter);
+	replay.events.push_back(uint8_t(g_PlacementTag | placement.rotation));
+	replay.events.push_back(uint8_t(int8_t(placement.x)));
+	replay.events.push_back(uint8_t(int8_t(placement.y)));
+}
+
+void FinishRecording(Replay& replay, const GameState& state)
+{
+	ReplayHeader& header{ replay.header };
+	header.boardHash = state.board.hash;
+	header.nrBytes = uint32_t(replay.events.size());
+	header.endStep = uint32_t(state.counter);
+	header.blocksUsed = uint32_t(state.blocksUsed);
+	header.lines = uint32_t(state.lines);
+	header.score = uint32_t(state.score);
+	header.isGameOver = state.isGameOver ? 1 : 0;
+}
+
+bool SaveReplay(const Replay& replay, const char* path)
+{
+	FILE* pFile{ fopen(path, "wb") };
+	if (!pFile)
+	{
+		return false;
+	}
+	bool isWritten{ fwrite(&replay.header, sizeof(replay.header), 1, pFile) == 1 };
+	if (isWritten && !replay.events.empty())
+	{
+		isWritten = fwrite(replay.events.data(), replay.events.size(), 1, pFile) == 1;
+	}
+	return fclose(pFile) == 0 && isWritten;
+}
+
+bool LoadReplay(Replay& replay, const char* path)
+{
+	FILE* pFile{ fopen(path, "rb") };
+	if (!pFile)
+	{
+		return false;
+	}
+	bool isRead{ fread(&replay.header, sizeof(replay.header), 1, pFile) == 1 };
+	isRead = isRead && memcmp(replay.header.magic, g_ReplayMagic, sizeof(g_ReplayMagic)) == 0 && replay.header.version == g_ReplayVersion
+		&& IsHeaderPossible(replay.header);
+	// The events have to be in the file before they are allocated, a broken header could ask for 4 GB
+	if (isRead)
+	{
+		long start{ ftell(pFile) };
+		isRead = fseek(pFile, 0, SEEK_END) == 0;
+		long end{ ftell(pFile) };
+		isRead = isRead && start >= 0 && end >= start && uint64_t(end - start) >= replay.header.nrBytes && fseek(pFile, start, SEEK_SET) == 0;
+	}
+	if (isRead)
+	{
+		replay.events.resize(replay.header.nrBytes);
+		isRead = replay.events.empty() || fread(replay.events.data(), replay.events.size(), 1, pFile) == 1;
+	}
+	fclose(pFile);
+	replay.lastStep = replay.header.endStep;
+	return isRead;
+}
+
+void StartPlayback(ReplayPlayer& player, const ReplayView& replay)
+{
+	player.replay = replay;
+	ReplayKeyframe& position{ player.position };
+	NewGame(position.state, replay.seed);
+	position.state.gravityPerStep = replay.gravityPerStep;
+	position.offset = 0;
+	position.eventStep = 0;
+	position.isBroken = false;
+	player.keyframes.clear();
+	player.keyframes.push_back(position);
+}
+
+void PlayReplay(ReplayPlayer& player, uint32_t step)
+{
+	// Placements can come after the last step, playing to the end plays those too
+	const ReplayView& replay{ player.replay };
+	bool isToEnd{ step >= replay.endStep };
+	step = isToEnd ? replay.endStep : step;
+	ReplayKeyframe& position{ player.position };
+	GameState& state{ position.state };
+	while (!state.isGameOver)
+	{
+		uint32_t eventStep{};
+		bool hasEvent{ PeekEvent(replay, position, eventStep) };
+		if (hasEvent && eventStep <= uint32_t(state.counter) && (eventStep < step || isToEnd))
+		{
+			ApplyEvent(position, replay);
+			continue;
+		}
+		if (uint32_t(state.counter) >= step)
+		{
+			return;
+		}
+
+		// Only steps that no event happened in yet, so seeking to a keyframe's step never skips that step's events
+		uint32_t counter{ uint32_t(state.counter) };
+		uint32_t keyframeStep{ uint32_t(player.keyframes.back().state.counter + g_KeyframeInterval) };
+		if (counter >= keyframeStep)
+		{
+			if (counter > position.eventStep)
+			{
+				player.keyframes.push_back(position);
+				keyframeStep = counter + g_KeyframeInterval;
+			}
+			else
+			{
+				keyframeStep = counter + 1;
+			}
+		}
+		// Skipping stops at the next event, the step asked for or the next keyframe, whichever comes first
+		uint32_t target{ hasEvent && eventStep < step ? eventStep : step };
+		target = keyframeStep < target ? keyframeStep : target;
+		SkipIdleSteps(state, target - counter);
+	}
+}
+
+void SeekReplay(ReplayPlayer& player, uint32_t step)
+{
+	// Backwards from the last keyframe at or before the step, forwards from where the player is
+	if (step < uint32_t(player.position.state.counter))
+	{
+		auto it{ std::upper_bound(player.keyframes.begin(), player.keyframes.end(), step,
+			[](uint32_t value, const ReplayKeyframe& keyframe) { return value < uint32_t(keyframe.state.counter); }) };
+		player.position = *(it - 1);
+	}
+	PlayReplay(player, step);
+}
+
+bool IsReplayDone(const ReplayPlayer& player)
+{
+	const ReplayKeyframe& position{ player.position };
+	return position.state.isGameOver || (position.offset >= player.replay.nrBytes && uint32_t(position.state.counter) >= player.replay.endStep);
+}
+
+bool MatchesRecording(const ReplayHeader& header, const GameState& state)
+{
+	return state.board.hash == header.boardHash && uint32_t(state.blocksUsed) == header.blocksUsed && uint32_t(state.lines) == header.lines
+		&& uint32_t(state.score) == header.score && state.isGameOver == (header.isGameOver != 0);
+}
+
+bool IsHeaderPossible(const ReplayHeader& header)
+{
+	// Every event takes at least two bytes, a piece locks on a drop or an event, a line takes ten cells of the four
+	// a piece has, and no line scores more than a tetris does
+	uint64_t nrDrops{ (uint64_t(header.endStep) + 1) * header.gravityPerStep / g_GravityUnit + 1 };
+	return header.gravityPerStep > 0 && uint64_t(header.nrEvents) * 2 <= header.nrBytes
+		&& header.blocksUsed <= nrDrops + header.nrEvents
+		&& uint64_t(header.lines) * g_BoardWidth <= uint64_t(header.blocksUsed) * 4
+		&& uint64_t(header.score) <= uint64_t(header.lines) * g_LineScores[4];
+}
+
+void AddEvent(Replay& replay, uint32_t step)
+{
+	// 7 bits at a time, low bits first, the high bit says more bytes follow
+	uint32_t delta{ step - replay.lastStep };
+	while (delta >= 0x80)
+	{
+		replay.events.push_back(uint8_t(delta | 0x80));
+		delta >>= 7;
+	}
+	replay.events.push_back(uint8_t(delta));
+	replay.lastStep = step;
+	replay.header.nrEvents++;
+}
+
+bool ReadVarint(const ReplayView& replay, uint32_t& offset, uint32_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 32 && offset < replay.nrBytes; shift += 7)
+	{
+		uint8_t byte{ replay.pEvents[offset++] };
+		value |= uint32_t(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PeekEvent(const ReplayView& replay, ReplayKeyframe& position, uint32_t& step)
+{
+	if (position.offset >= replay.nrBytes)
+	{
+		return false;
+	}
+	// An event cut off in its step or before its tag ends the playback like a cut off placement does
+	uint32_t offset{ position.offset };
+	uint32_t delta{};
+	if (!ReadVarint(replay, offset, delta) || offset >= replay.nrBytes)
+	{
+		position.offset = replay.nrBytes;
+		position.isBroken = true;
+		return false;
+	}
+	step = position.eventStep + delta;
+	return true;
+}
+
+void ApplyEvent(ReplayKeyframe& position, const ReplayView& replay)
+{
+	const uint8_t* pEvents{ replay.pEvents };
+	uint32_t delta{};
+	ReadVarint(replay, position.offset, delta);
+	position.eventStep += delta;
+	uint8_t tag{ pEvents[position.offset++] };
+	if ((tag & g_PlacementTag) == 0)
+	{
+		ApplyInput(position.state, tag);
+		return;
+	}
+
+	// A cut off placement ends the playback like the end of the events does
+	if (position.offset + 2 > replay.nrBytes)
+	{
+		position.offset = replay.nrBytes;
+		position.isBroken = true;
+		return;
+	}
+	Placement placement{ int8_t(pEvents[position.offset]), int8_t(pEvents[position.offset + 1]), tag & (g_NrRotations - 1) };
+	position.offset += 2;
+	// So does a placement the piece can't be locked at
+	if (!ApplyPlacement(position.state, placement))
+	{
+		position.offset = replay.nrBytes;
+		position.isBroken = true;
+	}
+}
+
+void SkipIdleSteps(GameState& state, uint32_t nrSteps)
+{
+	// Same as that many steps without input, but all steps until the next drop are skipped at once
+	while (nrSteps > 0 && !state.isGameOver)
+	{
+		uint32_t nrIdle{ std::min(nrSteps, uint32_t(StepsUntilDrop(state))) };
+		SkipSteps(state, int(nrIdle));
+		nrSteps -= nrIdle;
+		if (nrSteps > 0)
+		{
+			Step(state, InputNone);
+			nrSteps--;
+		}
+	}
+}
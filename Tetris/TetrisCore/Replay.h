@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "GameState.h"
+
+// A recorded game: the seed and gravity, then only what the player did, replayed through the same simulation.
+// Every event is the number of steps since the previous event as a varint, followed by one tag byte:
+// input flags applied before that step, or a placement tag with the rotation in its low bits followed by x and y
+// as signed bytes. Steps without input aren't stored at all, so a piece costs a few bytes.
+// Version 2 applies input without stepping, version 1 stepped with it and isn't read anymore.
+// The binary format is the header as it is in memory followed by the event bytes.
+const char g_ReplayMagic[4]{ 'T', 'R', 'P', 'L' };
+const uint32_t g_ReplayVersion{ 2 };
+const uint8_t g_PlacementTag{ 0x80 };
+const int g_KeyframeInterval{ 5 * g_StepsPerSecond }; // steps between the snapshots playback seeks from
+
+struct ReplayHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t seed;
+	uint64_t boardHash; // the result of the game, so a playback can be checked against it
+	uint32_t gravityPerStep;
+	uint32_t nrEvents;
+	uint32_t nrBytes; // of the events
+	uint32_t endStep; // counter when the recording stopped
+	uint32_t blocksUsed;
+	uint32_t lines;
+	uint32_t score;
+	uint32_t isGameOver;
+};
+static_assert(sizeof(ReplayHeader) == 56, "binary replay layout changed");
+
+struct Replay
+{
+	ReplayHeader header;
+	std::vector<uint8_t> events;
+	uint32_t lastStep; // of the last event recorded, the next delta counts from there
+};
+
+// Recording, StartRecording right after NewGame and the others right before the state changes
+void StartRecording(Replay& replay, const GameState& state);
+void RecordInput(Replay& replay, const GameState& state, uint8_t input);
+void RecordPlacement(Replay& replay, const GameState& state, const Placement& placement);
+void FinishRecording(Replay& replay, const GameState& state);
+
+// Return false when the file can't be opened or isn't a replay of this version, or its header can't be right
+bool SaveReplay(const Replay& replay, const char* path);
+bool LoadReplay(Replay& replay, const char* path);
+
+// What playback reads: a recording's events where they are, in a Replay or in a mapped corpus, without a copy
+struct ReplayView
+{
+	uint64_t seed;
+	uint32_t gravityPerStep;
+	uint32_t endStep;
+	const uint8_t* pEvents;
+	uint32_t nrBytes;
+};
+
+inline ReplayView ViewReplay(const Replay& replay)
+{
+	return ReplayView{ replay.header.seed, replay.header.gravityPerStep, replay.header.endStep, replay.events.data(), uint32_t(replay.events.size()) };
+}
+
+// The player's position in the game, also what a keyframe restores
+struct ReplayKeyframe
+{
+	GameState state;
+	uint32_t offset; // of the next event
+	uint32_t eventStep; // step of the event before it
+	bool isBroken; // an event that was cut off or couldn't be applied ended the playback
+};
+
+// Playback keeps a keyframe every g_KeyframeInterval steps it passes, seeking back starts from the last one before
+// the step and seeking forward just plays on. Steps without events are skipped until the next drop at once,
+// so a headless playback runs through millions of steps per second.
+struct ReplayPlayer
+{
+	ReplayView replay;
+	ReplayKeyframe position;
+	std::vector<ReplayKeyframe> keyframes;
+};
+
+// The events have to stay where they are until the playback is done
+void StartPlayback(ReplayPlayer& player, const ReplayView& replay);
+// Plays up to the state at step, before the events of that step, or until the recording ends
+void PlayReplay(ReplayPlayer& player, uint32_t step);
+void SeekReplay(ReplayPlayer& player, uint32_t step);
+bool IsReplayDone(const ReplayPlayer& player);
+// Whether the state ended up as the recorded game did
+bool MatchesRecording(const ReplayHeader& header, const GameState& state);
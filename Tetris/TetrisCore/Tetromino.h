@@ -0,0 +1,147 @@
+#pragma once
+#include <cstdint>
+#include "Bitboard.h"
+
+enum class BlockTypes
+{
+	Square, Line, zBlock, sBlock, tBlock, lBlock, jBlock
+};
+const int g_NrBlockTypes{ 7 };
+const int g_GarbageBlock{ g_NrBlockTypes }; // color of the rows an opponent sends in a versus match
+const int g_NrRotations{ 4 };
+const int g_NrKicks{ 5 };
+
+// Cells of every block type in its spawn rotation, relative to the cell the piece rotates around.
+// Rotating them around (0, 0) and then trying the kicks below gives the Super Rotation System.
+constexpr PieceCell g_SpawnCells[g_NrBlockTypes][4]
+{
+	{ { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } }, // Square
+	{ { -1, 0 }, { 0, 0 }, { 1, 0 }, { 2, 0 } }, // Line
+	{ { -1, 1 }, { 0, 1 }, { 0, 0 }, { 1, 0 } }, // zBlock
+	{ { -1, 0 }, { 0, 0 }, { 0, 1 }, { 1, 1 } }, // sBlock
+	{ { -1, 0 }, { 0, 0 }, { 1, 0 }, { 0, 1 } }, // tBlock
+	{ { -1, 0 }, { 0, 0 }, { 1, 0 }, { 1, 1 } }, // lBlock
+	{ { -1, 1 }, { -1, 0 }, { 0, 0 }, { 1, 0 } } // jBlock
+};
+
+// Offsets of the five rotation tests per rotation state, a kick is the offset of the old state minus that of the new one
+constexpr PieceCell g_SquareOffsets[g_NrRotations][g_NrKicks]
+{
+	{ { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } },
+	{ { 0, -1 }, { 0, -1 }, { 0, -1 }, { 0, -1 }, { 0, -1 } },
+	{ { -1, -1 }, { -1, -1 }, { -1, -1 }, { -1, -1 }, { -1, -1 } },
+	{ { -1, 0 }, { -1, 0 }, { -1, 0 }, { -1, 0 }, { -1, 0 } }
+};
+constexpr PieceCell g_LineOffsets[g_NrRotations][g_NrKicks]
+{
+	{ { 0, 0 }, { -1, 0 }, { 2, 0 }, { -1, 0 }, { 2, 0 } },
+	{ { -1, 0 }, { 0, 0 }, { 0, 0 }, { 0, 1 }, { 0, -2 } },
+	{ { -1, 1 }, { 1, 1 }, { -2, 1 }, { 1, 0 }, { -2, 0 } },
+	{ { 0, 1 }, { 0, 1 }, { 0, 1 }, { 0, -1 }, { 0, 2 } }
+};
+constexpr PieceCell g_DefaultOffsets[g_NrRotations][g_NrKicks]
+{
+	{ { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } },
+	{ { 0, 0 }, { 1, 0 }, { 1, -1 }, { 0, 2 }, { 1, 2 } },
+	{ { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } },
+	{ { 0, 0 }, { -1, 0 }, { -1, -1 }, { 0, 2 }, { -1, 2 } }
+};
+
+// Everything about a piece that the game needs, looked up by [blockType][rotation]
+struct PieceTables
+{
+	PieceMask masks[g_NrBlockTypes][g_NrRotations];
+	PieceCell kicks[g_NrBlockTypes][g_NrRotations][2][g_NrKicks]; // [0] turning clockwise, [1] counterclockwise
+	int spawnY[g_NrBlockTypes];
+};
+
+constexpr PieceTables MakePieceTables()
+{
+	PieceTables tables{};
+	for (int type = 0; type < g_NrBlockTypes; type++)
+	{
+		const PieceCell(*offsets)[g_NrKicks]{ type == int(BlockTypes::Square) ? g_SquareOffsets
+			: type == int(BlockTypes::Line) ? g_LineOffsets : g_DefaultOffsets };
+
+		int spawnTop{ -4 };
+		for (int i = 0; i < 4; i++)
+		{
+			tables.masks[type][0].cells[i] = g_SpawnCells[type][i];
+			spawnTop = g_SpawnCells[type][i].y > spawnTop ? g_SpawnCells[type][i].y : spawnTop;
+		}
+		tables.spawnY[type] = g_VisibleRows - 1 - spawnTop;
+
+		for (int rotation = 0; rotation < g_NrRotations; rotation++)
+		{
+			// Turn the cells of the previous rotation a quarter clockwise, (x, y) becomes (y, -x)
+			if (rotation > 0)
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					const PieceCell& cell{ tables.masks[type][rotation - 1].cells[i] };
+					tables.masks[type][rotation].cells[i] = PieceCell{ cell.y, -cell.x };
+				}
+			}
+
+			int left{ 4 }, bottom{ 4 }, right{ -4 }, top{ -4 };
+			for (int i = 0; i < 4; i++)
+			{
+				const PieceCell& cell{ tables.masks[type][rotation].cells[i] };
+				left = cell.x < left ? cell.x : left;
+				right = cell.x > right ? cell.x : right;
+				bottom = cell.y < bottom ? cell.y : bottom;
+				top = cell.y > top ? cell.y : top;
+			}
+
+			PieceMask& mask{ tables.masks[type][rotation] };
+			mask.left = left;
+			mask.bottom = bottom;
+			mask.width = right - left + 1;
+			mask.height = top - bottom + 1;
+			for (int i = 0; i < 4; i++)
+			{
+				const PieceCell& cell{ tables.masks[type][rotation].cells[i] };
+				mask.rows[cell.y - bottom] |= uint16_t(1 << (cell.x - left));
+			}
+
+			for (int turn = 0; turn < 2; turn++)
+			{
+				int next{ (rotation + (turn == 0 ? 1 : g_NrRotations - 1)) % g_NrRotations };
+				for (int i = 0; i < g_NrKicks; i++)
+				{
+					tables.kicks[type][rotation][turn][i] = PieceCell{ offsets[rotation][i].x - offsets[next][i].x,
+						offsets[rotation][i].y - offsets[next][i].y };
+				}
+			}
+		}
+	}
+	return tables;
+}
+
+constexpr PieceTables g_PieceTables{ MakePieceTables() };
+const int g_SpawnX{ 4 };
+
+inline const PieceMask& GetPieceMask(int blockType, int rotation)
+{
+	return g_PieceTables.masks[blockType][rotation];
+}
+
+// Turns a piece a quarter, turn 0 is clockwise and 1 counterclockwise. The first kick that fits wins,
+// when none fits the piece stays as it was and false is returned.
+inline bool RotatePiece(const Board& board, int blockType, int turn, int& x, int& y, int& rotation)
+{
+	int next{ (rotation + (turn == 0 ? 1 : g_NrRotations - 1)) % g_NrRotations };
+	const PieceMask& piece{ GetPieceMask(blockType, next) };
+	const PieceCell* kicks{ g_PieceTables.kicks[blockType][rotation][turn] };
+	for (int i = 0; i < g_NrKicks; i++)
+	{
+		if (!Collides(board, piece, x + kicks[i].x, y + kicks[i].y))
+		{
+			x += kicks[i].x;
+			y += kicks[i].y;
+			rotation = next;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,163 @@
+#include "Trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+TraceLevel g_TraceLevel{ TraceLevel::Off };
+
+// Single producer, single consumer ring: the game thread only moves the head and the writer only moves the tail
+TraceRecord g_TraceRing[g_TraceCapacity];
+std::atomic<uint32_t> g_TraceHead{};
+std::atomic<uint32_t> g_TraceTail{};
+std::atomic<uint32_t> g_TraceDropped{};
+std::atomic<bool> g_IsTraceRunning{};
+std::thread g_TraceWriter{};
+FILE* g_pTraceFile{ nullptr };
+TraceFormat g_TraceFormat{ TraceFormat::Text };
+
+const char g_FigureNames[]{ "OIZSTLJ" };
+
+void WriteTraceRecord(const TraceRecord& record)
+{
+	if (g_TraceFormat == TraceFormat::Binary)
+	{
+		fwrite(&record, sizeof(record), 1, g_pTraceFile);
+		return;
+	}
+
+	switch (record.event)
+	{
+	case TraceEvent::Spawn:
+		fprintf(g_pTraceFile, "%u spawn %c\n", record.step, g_FigureNames[record.figure]);
+		break;
+	case TraceEvent::GameOver:
+		fprintf(g_pTraceFile, "%u game over\n", record.step);
+		break;
+	case TraceEvent::Board:
+		fprintf(g_pTraceFile, "%u board height %u\n", record.step, record.height);
+		// Top row first, so the dump looks like the playfield
+		for (int i = g_VisibleRows - 1; i >= 0; i--)
+		{
+			char line[g_BoardWidth + 2];
+			for (int j = 0; j < g_BoardWidth; j++)
+			{
+				line[j] = (record.rows[i] >> j) & 1 ? '#' : '.';
+			}
+			line[g_BoardWidth] = '\n';
+			line[g_BoardWidth + 1] = '\0';
+			fputs(line, g_pTraceFile);
+		}
+		break;
+	}
+}
+
+int DrainTrace()
+{
+	uint32_t tail{ g_TraceTail.load(std::memory_order_relaxed) };
+	uint32_t head{ g_TraceHead.load(std::memory_order_acquire) };
+	for (uint32_t i = tail; i != head; i++)
+	{
+		WriteTraceRecord(g_TraceRing[i & (g_TraceCapacity - 1)]);
+	}
+	g_TraceTail.store(head, std::memory_order_release);
+	return int(head - tail);
+}
+
+void RunTraceWriter()
+{
+	while (g_IsTraceRunning.load(std::memory_order_acquire))
+	{
+		if (DrainTrace() > 0)
+		{
+			fflush(g_pTraceFile);
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+	// Whatever was added before StopTrace still gets written
+	DrainTrace();
+	fflush(g_pTraceFile);
+}
+
+bool StartTrace(TraceLevel level, TraceFormat format, const char* path)
+{
+	StopTrace();
+	if (level == TraceLevel::Off)
+	{
+		return true;
+	}
+
+	g_pTraceFile = path ? fopen(path, format == TraceFormat::Binary ? "wb" : "w") : stdout;
+	if (!g_pTraceFile)
+	{
+		return false;
+	}
+	g_TraceFormat = format;
+	if (format == TraceFormat::Binary)
+	{
+		fwrite(g_TraceMagic, sizeof(g_TraceMagic), 1, g_pTraceFile);
+		fwrite(&g_TraceVersion, sizeof(g_TraceVersion), 1, g_pTraceFile);
+	}
+
+	g_TraceHead.store(0);
+	g_TraceTail.store(0);
+	g_TraceDropped.store(0);
+	g_IsTraceRunning.store(true);
+	g_TraceWriter = std::thread{ RunTraceWriter };
+	g_TraceLevel = level;
+	return true;
+}
+
+void StopTrace()
+{
+	if (!g_TraceWriter.joinable())
+	{
+		return;
+	}
+
+	g_TraceLevel = TraceLevel::Off;
+	g_IsTraceRunning.store(false, std::memory_order_release);
+	g_TraceWriter.join();
+
+	uint32_t nrDropped{ g_TraceDropped.load() };
+	if (nrDropped > 0 && g_TraceFormat == TraceFormat::Text)
+	{
+		fprintf(g_pTraceFile, "%u records dropped\n", nrDropped);
+	}
+	if (g_pTraceFile != stdout)
+	{
+		fclose(g_pTraceFile);
+	}
+	g_pTraceFile = nullptr;
+}
+
+uint32_t GetDroppedTraceRecords()
+{
+	return g_TraceDropped.load(std::memory_order_relaxed);
+}
+
+void AddTraceRecord(const TraceRecord& record)
+{
+	uint32_t head{ g_TraceHead.load(std::memory_order_relaxed) };
+	if (head - g_TraceTail.load(std::memory_order_acquire) == g_TraceCapacity)
+	{
+		// The writer fell behind, losing a record is better than stalling the game
+		g_TraceDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	g_TraceRing[head & (g_TraceCapacity - 1)] = record;
+	g_TraceHead.store(head + 1, std::memory_order_release);
+}
+
+void AddBoardRecord(uint32_t step, const Board& board)
+{
+	TraceRecord record{ step, TraceEvent::Board, 0, uint16_t(board.height) };
+	for (int i = 0; i < g_VisibleRows; i++)
+	{
+		record.rows[i] = board.filled[i];
+	}
+	AddTraceRecord(record);
+}
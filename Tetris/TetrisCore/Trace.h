@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include "Bitboard.h"
+
+// Debug trace of what happens in a game. Records are copied into a lock-free ring buffer and written to a file
+// by a background thread, so tracing never blocks the thread that plays the game. Only one thread may add records.
+enum class TraceLevel : uint8_t
+{
+	Off, Pieces, Boards
+};
+
+enum class TraceFormat : uint8_t
+{
+	Text, Binary
+};
+
+enum class TraceEvent : uint8_t
+{
+	Spawn, Board, GameOver
+};
+
+// One fixed size record, the binary format is the 8 byte file header followed by these records as they are in memory
+struct TraceRecord
+{
+	uint32_t step;
+	TraceEvent event;
+	uint8_t figure;
+	uint16_t height;
+	uint16_t rows[g_VisibleRows];
+};
+static_assert(sizeof(TraceRecord) == 40, "binary trace layout changed");
+
+const char g_TraceMagic[4]{ 'T', 'T', 'R', 'C' };
+const uint32_t g_TraceVersion{ 1 };
+const int g_TraceCapacity{ 1024 }; // records, a power of two
+
+extern TraceLevel g_TraceLevel;
+
+// path nullptr writes to stdout, returns false when the file can't be opened
+bool StartTrace(TraceLevel level, TraceFormat format, const char* path);
+void StopTrace();
+uint32_t GetDroppedTraceRecords();
+
+void AddTraceRecord(const TraceRecord& record);
+
+// The level check is inlined so a disabled trace costs one compare and never touches the board
+inline bool IsTracing(TraceLevel level)
+{
+	return g_TraceLevel >= level;
+}
+
+inline void TraceSpawn(uint32_t step, int figure)
+{
+	if (IsTracing(TraceLevel::Pieces))
+	{
+		TraceRecord record{ step, TraceEvent::Spawn, uint8_t(figure) };
+		AddTraceRecord(record);
+	}
+}
+
+inline void TraceGameOver(uint32_t step)
+{
+	if (IsTracing(TraceLevel::Pieces))
+	{
+		TraceRecord record{ step, TraceEvent::GameOver };
+		AddTraceRecord(record);
+	}
+}
+
+void AddBoardRecord(uint32_t step, const Board& board);
+
+inline void TraceBoard(uint32_t step, const Board& board)
+{
+	if (IsTracing(TraceLevel::Boards))
+	{
+		AddBoardRecord(step, board);
+	}
+}
@@ -0,0 +1,41 @@
+#include "TranspositionTable.h"
+
+void InitTable(TranspositionTable& table, int megabytes)
+{
+	table.pEntries.reset();
+	table.mask = 0;
+	if (megabytes <= 0)
+	{
+		return;
+	}
+
+	uint64_t nrEntries{ 1 };
+	while (nrEntries * 2 * sizeof(TableEntry) <= uint64_t(megabytes) << 20)
+	{
+		nrEntries *= 2;
+	}
+	table.pEntries.reset(new TableEntry[nrEntries]);
+	table.mask = nrEntries - 1;
+	ClearTable(table);
+}
+
+void ClearTable(TranspositionTable& table)
+{
+	if (table.pEntries == nullptr)
+	{
+		return;
+	}
+	for (uint64_t i = 0; i <= table.mask; i++)
+	{
+		table.pEntries[i].check.store(0, std::memory_order_relaxed);
+		table.pEntries[i].data.store(0, std::memory_order_relaxed);
+	}
+}
+
+void AddTableStats(TableStats& total, const TableStats& stats)
+{
+	total.probes += stats.probes;
+	total.hits += stats.hits;
+	total.collisions += stats.collisions;
+	total.stores += stats.stores;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Board evaluations by board hash, in a fixed size table shared by all search threads without locks.
+// An entry is two words written separately. The check word is the hash xor'ed with the data word, so when
+// two threads write the same entry at once the torn result matches neither hash and only costs a miss.
+struct TableEntry
+{
+	std::atomic<uint64_t> check;
+	std::atomic<uint64_t> data;
+};
+
+// Counted per search thread and added up when the search is done
+struct TableStats
+{
+	uint64_t probes;
+	uint64_t hits;
+	uint64_t collisions; // probes that found another board in the entry
+	uint64_t stores;
+};
+
+struct TranspositionTable
+{
+	std::unique_ptr<TableEntry[]> pEntries;
+	uint64_t mask; // number of entries - 1, always a power of 2
+};
+
+// Rounds down to a power of 2 entries, 0 megabytes leaves the table empty and every probe a miss
+void InitTable(TranspositionTable& table, int megabytes);
+void ClearTable(TranspositionTable& table);
+void AddTableStats(TableStats& total, const TableStats& stats);
+
+// The low word of the data is the score, the bit above it tells an empty entry apart from a stored 0
+const uint64_t g_EntryUsed{ uint64_t(1) << 32 };
+
+inline bool ProbeTable(const TranspositionTable& table, uint64_t hash, float& score, TableStats& stats)
+{
+	if (table.pEntries == nullptr)
+	{
+		return false;
+	}
+	stats.probes++;
+	const TableEntry& entry{ table.pEntries[hash & table.mask] };
+	uint64_t data{ entry.data.load(std::memory_order_relaxed) };
+	uint64_t check{ entry.check.load(std::memory_order_relaxed) };
+	if ((data & g_EntryUsed) == 0)
+	{
+		return false;
+	}
+	if ((check ^ data) != hash)
+	{
+		stats.collisions++;
+		return false;
+	}
+	uint32_t bits{ uint32_t(data) };
+	memcpy(&score, &bits, sizeof(score));
+	stats.hits++;
+	return true;
+}
+
+// Always replaces what was in the entry, the newest boards are the likeliest to come back
+inline void StoreTable(TranspositionTable& table, uint64_t hash, float score, TableStats& stats)
+{
+	if (table.pEntries == nullptr)
+	{
+		return;
+	}
+	stats.stores++;
+	uint32_t bits{};
+	memcpy(&bits, &score, sizeof(bits));
+	uint64_t data{ g_EntryUsed | bits };
+	TableEntry& entry{ table.pEntries[hash & table.mask] };
+	entry.check.store(hash ^ data, std::memory_order_relaxed);
+	entry.data.store(data, std::memory_order_relaxed);
+}
@@ -0,0 +1,254 @@
+#include "Versus.h"
+#include <algorithm>
+#include <thread>
+
+// Matches are set up in rounds, so the memory stays the same however many are played
+const uint32_t g_VersusRound{ 8192 };
+// Steps a board takes before its worker moves on to the next board, so no board waits long for its opponent
+const uint32_t g_VersusSlice{ 256 };
+
+void SetUpBoard(VersusBoard& board, VersusBoard& opponent, BeamSearch& search, uint64_t seed, int side, const VersusSettings& settings);
+void RunVersusWorker(std::vector<VersusBoard*> boards, uint32_t maxSteps);
+bool AdvanceBoard(VersusBoard& board, uint32_t maxSteps);
+uint32_t ReceiveGarbage(VersusBoard& board, uint32_t step, uint32_t limit);
+void SendGarbage(VersusBoard& board, uint32_t step);
+void FinishBoard(VersusBoard& board, uint32_t maxSteps);
+
+void PlayVersus(const VersusSettings& settings, std::vector<VersusResult>& results)
+{
+	int nrThreads{ std::max(1, settings.nrThreads) };
+	results.resize(settings.nrMatches);
+	std::vector<VersusBoard> boards(2 * std::min(settings.nrMatches, g_VersusRound));
+	// One search per worker for all its boards, board i goes to worker i % nrThreads
+	std::vector<BeamSearch> searches(nrThreads);
+	for (uint32_t first = 0; first < settings.nrMatches; first += g_VersusRound)
+	{
+		uint32_t nrMatches{ std::min(settings.nrMatches - first, g_VersusRound) };
+		for (uint32_t i = 0; i < nrMatches; i++)
+		{
+			uint64_t seed{ settings.firstSeed + first + i };
+			SetUpBoard(boards[2 * i], boards[2 * i + 1], searches[2 * i % nrThreads], seed, 0, settings);
+			SetUpBoard(boards[2 * i + 1], boards[2 * i], searches[(2 * i + 1) % nrThreads], seed, 1, settings);
+		}
+
+		// Neighbouring boards go to different workers, so the two sides of a match run in parallel
+		std::vector<std::vector<VersusBoard*>> shares(nrThreads);
+		for (uint32_t i = 0; i < 2 * nrMatches; i++)
+		{
+			shares[i % nrThreads].push_back(&boards[i]);
+		}
+		std::vector<std::thread> workers;
+		for (int i = 1; i < nrThreads; i++)
+		{
+			workers.emplace_back(RunVersusWorker, std::move(shares[i]), settings.maxSteps);
+		}
+		RunVersusWorker(std::move(shares[0]), settings.maxSteps);
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		for (uint32_t i = 0; i < nrMatches; i++)
+		{
+			const VersusBoard* pSides[2]{ &boards[2 * i], &boards[2 * i + 1] };
+			uint32_t overSteps[2]{ pSides[0]->overStep.load(), pSides[1]->overStep.load() };
+			VersusResult& result{ results[first + i] };
+			result.seed = settings.firstSeed + first + i;
+			result.nrSteps = std::min(std::min(overSteps[0], overSteps[1]), settings.maxSteps);
+			result.winner = overSteps[0] == overSteps[1] ? -1 : overSteps[0] < overSteps[1] ? 1 : 0;
+			for (int j = 0; j < 2; j++)
+			{
+				result.linesSent[j] = pSides[j]->linesSent;
+				result.nrPieces[j] = pSides[j]->state.blocksUsed;
+				result.nrFallbacks[j] = pSides[j]->policy.nrFallbacks;
+			}
+		}
+	}
+}
+
+void SetUpBoard(VersusBoard& board, VersusBoard& opponent, BeamSearch& search, uint64_t seed, int side, const VersusSettings& settings)
+{
+	// Both sides get the same pieces, the holes and the choices of a random player differ
+	NewGame(board.state, seed, settings.gravity);
+	board.policy.pSearch = &search;
+	board.policy.nrFallbacks = 0;
+	ResetPolicy(board.policy, settings.policy, seed * 2 + side);
+	SeedRandom(board.holes, ~(seed * 2 + side));
+	for (int& clears : board.clears)
+	{
+		clears = 0;
+	}
+	board.pendingLines = 0;
+	board.linesSent = 0;
+	board.linesReceived = 0;
+	board.isDone = false;
+	board.pOpponent = &opponent;
+	board.inbox.head.store(0, std::memory_order_relaxed);
+	board.inbox.tail.store(0, std::memory_order_relaxed);
+	board.nrSteps.store(0, std::memory_order_relaxed);
+	board.overStep.store(g_NotOver, std::memory_order_relaxed);
+}
+
+void RunVersusWorker(std::vector<VersusBoard*> boards, uint32_t maxSteps)
+{
+	while (!boards.empty())
+	{
+		bool hasAdvanced{ false };
+		for (size_t i = 0; i < boards.size();)
+		{
+			hasAdvanced |= AdvanceBoard(*boards[i], maxSteps);
+			if (boards[i]->isDone)
+			{
+				boards[i] = boards.back();
+				boards.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+		// Every board left is waiting for an opponent on another worker
+		if (!hasAdvanced)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool AdvanceBoard(VersusBoard& board, uint32_t maxSteps)
+{
+	// The opponent's garbage up to opponentSteps - 1 is in the inbox, so every step up to opponentSteps + g_GarbageDelay - 1
+	// gets exactly the garbage due in it. Once the opponent lost, the garbage still on its way decides whether
+	// this board loses as well, so it plays until that has all arrived.
+	const VersusBoard& opponent{ *board.pOpponent };
+	uint32_t opponentSteps{ opponent.nrSteps.load(std::memory_order_acquire) };
+	uint32_t opponentOver{ opponent.overStep.load(std::memory_order_relaxed) };
+	uint32_t end{ opponentOver == g_NotOver ? maxSteps : std::min(maxSteps, opponentOver + g_GarbageDelay) };
+	uint32_t step{ board.nrSteps.load(std::memory_order_relaxed) };
+	uint32_t limit{ std::min({ end, opponentSteps + g_GarbageDelay, step + g_VersusSlice }) };
+	if (step >= end)
+	{
+		FinishBoard(board, maxSteps);
+		return true;
+	}
+	if (step >= limit)
+	{
+		return false;
+	}
+
+	GameState& state{ board.state };
+	while (step < limit)
+	{
+		uint32_t nextDue{ ReceiveGarbage(board, step, limit) };
+		if (!state.isMoving && board.pendingLines > 0)
+		{
+			AddGarbage(state, board.pendingLines, int(RandomBelow(board.holes, g_BoardWidth)));
+			board.linesReceived += board.pendingLines;
+			board.pendingLines = 0;
+		}
+		if (state.isGameOver)
+		{
+			break;
+		}
+
+		if (!state.isMoving)
+		{
+			// Nothing happens until the next piece spawns or more garbage comes in
+			uint32_t nrIdle{ std::min(uint32_t(StepsUntilDrop(state)), nextDue - step) };
+			if (nrIdle > 0)
+			{
+				SkipSteps(state, int(nrIdle));
+				step += nrIdle;
+				continue;
+			}
+		}
+		if (board.policy.type == PolicyType::Beam && state.isMoving)
+		{
+			if (!ApplyPlacement(state, ChoosePlacement(board.policy, state)))
+			{
+				board.policy.nrFallbacks++;
+			}
+			Step(state, InputNone);
+		}
+		else
+		{
+			Step(state, PlacementInput(board.policy, state));
+		}
+		SendGarbage(board, step);
+		if (state.isGameOver)
+		{
+			break;
+		}
+		step++;
+	}
+
+	if (state.isGameOver)
+	{
+		board.overStep.store(step, std::memory_order_relaxed);
+		FinishBoard(board, maxSteps);
+		return true;
+	}
+	board.nrSteps.store(step, std::memory_order_release);
+	if (step >= end)
+	{
+		FinishBoard(board, maxSteps);
+	}
+	return true;
+}
+
+uint32_t ReceiveGarbage(VersusBoard& board, uint32_t step, uint32_t limit)
+{
+	// Takes what is due in this step and returns when the next packet is, packets not sent yet can't be due before limit
+	GarbageQueue& inbox{ board.inbox };
+	uint32_t tail{ inbox.tail.load(std::memory_order_relaxed) };
+	uint32_t head{ inbox.head.load(std::memory_order_acquire) };
+	while (tail != head)
+	{
+		const GarbagePacket& packet{ inbox.packets[tail & (g_GarbageCapacity - 1)] };
+		if (packet.step + g_GarbageDelay > step)
+		{
+			limit = std::min(limit, packet.step + g_GarbageDelay);
+			break;
+		}
+		board.pendingLines += int(packet.nrLines);
+		tail++;
+	}
+	inbox.tail.store(tail, std::memory_order_release);
+	return limit;
+}
+
+void SendGarbage(VersusBoard& board, uint32_t step)
+{
+	int nrLines{};
+	for (int i = 0; i < 4; i++)
+	{
+		nrLines += (board.state.clears[i] - board.clears[i]) * g_GarbageLines[i + 1];
+		board.clears[i] = board.state.clears[i];
+	}
+	// Rows sent first cancel the rows that arrived and are still waiting to be pushed in
+	int nrCancelled{ std::min(nrLines, board.pendingLines) };
+	board.pendingLines -= nrCancelled;
+	nrLines -= nrCancelled;
+	if (nrLines == 0)
+	{
+		return;
+	}
+	board.linesSent += nrLines;
+
+	// The opponent is never far enough behind to fill its inbox, unless it's done and stopped reading it
+	GarbageQueue& inbox{ board.pOpponent->inbox };
+	uint32_t head{ inbox.head.load(std::memory_order_relaxed) };
+	if (head - inbox.tail.load(std::memory_order_acquire) == g_GarbageCapacity)
+	{
+		return;
+	}
+	inbox.packets[head & (g_GarbageCapacity - 1)] = GarbagePacket{ step, uint32_t(nrLines) };
+	inbox.head.store(head + 1, std::memory_order_release);
+}
+
+void FinishBoard(VersusBoard& board, uint32_t maxSteps)
+{
+	// The opponent never has to wait for a board that's done
+	board.isDone = true;
+	board.nrSteps.store(maxSteps, std::memory_order_release);
+}
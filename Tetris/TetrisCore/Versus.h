@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "GameState.h"
+#include "Policy.h"
+
+// Versus matches between two computer players that send each other garbage rows for the lines they clear.
+// The two boards of a match are stepped on different worker threads. Garbage sent in a step arrives
+// g_GarbageDelay steps later, so a board may run up to that many steps ahead of its opponent before it has
+// to wait for it. The boards apply exactly the garbage that is due, so a match plays out the same on any
+// number of threads.
+const int g_GarbageDelay{ 20 }; // steps, a third of a second
+const int g_GarbageCapacity{ 64 }; // packets, a power of two
+static_assert(g_GarbageCapacity > 2 * g_GarbageDelay, "a board can be that many steps of packets ahead of its opponent");
+// Rows sent for clearing 0 to 4 lines with one piece, before they cancel rows still waiting to come in
+const int g_GarbageLines[5]{ 0, 0, 1, 2, 4 };
+const uint32_t g_NotOver{ UINT32_MAX };
+
+// Rows sent during one step
+struct GarbagePacket
+{
+	uint32_t step;
+	uint32_t nrLines;
+};
+
+// Single producer, single consumer ring: the opponent only moves the head and the board itself only moves the tail
+struct GarbageQueue
+{
+	GarbagePacket packets[g_GarbageCapacity];
+	alignas(64) std::atomic<uint32_t> head;
+	alignas(64) std::atomic<uint32_t> tail;
+};
+
+struct alignas(64) VersusBoard
+{
+	GameState state;
+	Policy policy; // searches with its worker's search, so a board costs little more than its game
+	Random holes; // the column garbage rows leave open
+	int clears[4]; // of the state after the last step, what changed was cleared in the step
+	int pendingLines; // arrived but not pushed in yet, that waits for the current piece to lock
+	int linesSent;
+	int linesReceived;
+	bool isDone;
+	VersusBoard* pOpponent;
+	GarbageQueue inbox; // only the opponent adds to it
+	// Steps done, and the step the game was lost in. Once a board is done it reports the last step of the match.
+	alignas(64) std::atomic<uint32_t> nrSteps;
+	std::atomic<uint32_t> overStep;
+};
+
+struct VersusSettings
+{
+	uint64_t firstSeed;
+	uint32_t nrMatches;
+	PolicyType policy;
+	int nrThreads;
+	uint32_t maxSteps;
+	float gravity;
+};
+
+struct VersusResult
+{
+	uint64_t seed;
+	uint32_t nrSteps;
+	int winner; // 0 or 1, -1 when both lost in the same step or neither lost
+	int linesSent[2];
+	int nrPieces[2];
+	int nrFallbacks[2]; // pieces left to gravity because the player couldn't place them
+};
+
+// Plays nrMatches matches with seeds from firstSeed on, results in the order of the seeds
+void PlayVersus(const VersusSettings& settings, std::vector<VersusResult>& results);
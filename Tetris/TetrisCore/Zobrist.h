@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include "BoardSize.h"
+
+// Zobrist hashing of the filled cells: every cell has a random key and the hash of a board is the xor of
+// the keys of its filled cells. Locking a piece or moving rows down only xors out and in the rows that changed.
+// The keys are combined per chunk of a row ahead of time, a row of the game board takes two lookups.
+template<int Width, int Rows>
+struct ZobristKeys
+{
+	static constexpr int chunkBits{ BoardRow<Width>::chunkBits };
+	static constexpr int nrChunks{ (Width + chunkBits - 1) / chunkBits };
+	uint64_t chunks[Rows][nrChunks][1 << chunkBits];
+};
+
+template<int Width, int Rows>
+constexpr ZobristKeys<Width, Rows> MakeZobristKeys()
+{
+	using Keys = ZobristKeys<Width, Rows>;
+	// splitmix64 with a fixed seed, so hashes are the same in every build
+	uint64_t cellKeys[Rows][Keys::nrChunks * Keys::chunkBits]{};
+	uint64_t seed{ 0x5EED5EED5EED5EEDull };
+	for (int row = 0; row < Rows; row++)
+	{
+		for (int col = 0; col < Width; col++)
+		{
+			seed += 0x9E3779B97F4A7C15ull;
+			uint64_t z{ seed };
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			cellKeys[row][col] = z ^ (z >> 31);
+		}
+	}
+
+	// Every combination with its highest column in bit is one with that column left out plus that column,
+	// so each entry costs one xor and the wide boards still build at compile time
+	Keys keys{};
+	for (int row = 0; row < Rows; row++)
+	{
+		for (int chunk = 0; chunk < Keys::nrChunks; chunk++)
+		{
+			uint64_t* pKeys{ keys.chunks[row][chunk] };
+			for (int bit = 0; bit < Keys::chunkBits; bit++)
+			{
+				for (int bits = 1 << bit; bits < (2 << bit); bits++)
+				{
+					pKeys[bits] = pKeys[bits - (1 << bit)] ^ cellKeys[row][chunk * Keys::chunkBits + bit];
+				}
+			}
+		}
+	}
+	return keys;
+}
+
+template<int Width, int Rows>
+inline constexpr ZobristKeys<Width, Rows> g_ZobristKeys{ MakeZobristKeys<Width, Rows>() };
+
+// The game board is the default, the other boards name their size
+template<int Width = g_BoardWidth, int Rows = g_BoardRows>
+inline uint64_t HashRow(int row, typename BoardRow<Width>::Bits bits)
+{
+	using Keys = ZobristKeys<Width, Rows>;
+	const uint64_t (&chunks)[Keys::nrChunks][1 << Keys::chunkBits]{ g_ZobristKeys<Width, Rows>.chunks[row] };
+	uint64_t hash{};
+	for (int i = 0; i < Keys::nrChunks; i++)
+	{
+		hash ^= chunks[i][(bits >> (i * Keys::chunkBits)) & ((1 << Keys::chunkBits) - 1)];
+	}
+	return hash;
+}
+
+// Hash of rows first up to last, which are the rows at those heights
+template<int Width = g_BoardWidth, int Rows = g_BoardRows>
+inline uint64_t HashRows(const typename BoardRow<Width>::Bits* pRows, int first, int last)
+{
+	uint64_t hash{};
+	for (int i = first; i < last; i++)
+	{
+		hash ^= HashRow<Width, Rows>(i, pRows[i]);
+	}
+	return hash;
+}
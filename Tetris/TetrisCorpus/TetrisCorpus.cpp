@@ -0,0 +1,260 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "Corpus.h"
+
+// Packs recorded games into a corpus and runs queries over one. The filters and averages only read the index
+// columns straight from the mapping, --resim plays the selected games again on every core to count line clears
+// and check that every game still ends the way it was recorded. Games with events that can't be played are
+// counted and left out of the clears.
+struct QuerySettings
+{
+	const char* pPath;
+	uint32_t minScore, maxScore;
+	uint32_t minPieces;
+	bool isGameOverOnly;
+	bool isResim;
+	int nrThreads;
+};
+
+// Every worker only writes its own stats, they are added up after all workers are done
+struct alignas(64) ResimStats
+{
+	uint64_t nrGames;
+	uint64_t nrSteps;
+	uint64_t nrEventBytes;
+	uint64_t clears[4];
+	uint64_t nrMismatches;
+	uint64_t nrInvalid; // games with broken offsets or events, skipped
+};
+
+const uint64_t g_ResimChunk{ 256 }; // games a worker takes at once
+
+void PrintUsage();
+int Pack(int argc, char* args[]);
+bool ParseQuery(int argc, char* args[], QuerySettings& settings);
+int Query(const QuerySettings& settings);
+void RunResim(const Corpus& corpus, const std::vector<uint64_t>& games, std::atomic<uint64_t>& next, ResimStats& stats);
+
+int main(int argc, char* args[])
+{
+	if (argc >= 3 && strcmp(args[1], "pack") == 0)
+	{
+		return Pack(argc, args);
+	}
+	QuerySettings settings{ nullptr, 0, UINT32_MAX, 0, false, false, int(std::thread::hardware_concurrency()) };
+	if (argc >= 3 && strcmp(args[1], "query") == 0 && ParseQuery(argc, args, settings))
+	{
+		return Query(settings);
+	}
+	PrintUsage();
+	return 1;
+}
+
+void PrintUsage()
+{
+	printf("usage: tetris_corpus pack corpus file.replay...\n");
+	printf("       tetris_corpus query corpus [--min-score n] [--max-score n] [--min-pieces n] [--game-over] [--resim] [--threads n]\n");
+}
+
+int Pack(int argc, char* args[])
+{
+	CorpusWriter writer{};
+	if (!OpenCorpusWriter(writer, args[2]))
+	{
+		printf("could not write corpus %s\n", args[2]);
+		return 1;
+	}
+	Replay replay{};
+	int nrPacked{};
+	for (int i = 3; i < argc; i++)
+	{
+		if (!LoadReplay(replay, args[i]))
+		{
+			printf("skipped %s, not a replay or its header is broken\n", args[i]);
+			continue;
+		}
+		if (!AddToCorpus(writer, replay))
+		{
+			break;
+		}
+		nrPacked++;
+	}
+	if (!CloseCorpusWriter(writer))
+	{
+		printf("could not write corpus %s\n", args[2]);
+		return 1;
+	}
+	printf("packed %d games into %s\n", nrPacked, args[2]);
+	return 0;
+}
+
+bool ParseQuery(int argc, char* args[], QuerySettings& settings)
+{
+	settings.pPath = args[2];
+	for (int i = 3; i < argc; i++)
+	{
+		if (strcmp(args[i], "--min-score") == 0 && i + 1 < argc)
+		{
+			settings.minScore = uint32_t(strtoul(args[++i], nullptr, 10));
+		}
+		else if (strcmp(args[i], "--max-score") == 0 && i + 1 < argc)
+		{
+			settings.maxScore = uint32_t(strtoul(args[++i], nullptr, 10));
+		}
+		else if (strcmp(args[i], "--min-pieces") == 0 && i + 1 < argc)
+		{
+			settings.minPieces = uint32_t(strtoul(args[++i], nullptr, 10));
+		}
+		else if (strcmp(args[i], "--game-over") == 0)
+		{
+			settings.isGameOverOnly = true;
+		}
+		else if (strcmp(args[i], "--resim") == 0)
+		{
+			settings.isResim = true;
+		}
+		else if (strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+		{
+			settings.nrThreads = atoi(args[++i]);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int Query(const QuerySettings& settings)
+{
+	Corpus corpus{};
+	if (!OpenCorpus(corpus, settings.pPath))
+	{
+		printf("could not read corpus %s\n", settings.pPath);
+		return 1;
+	}
+
+	// One pass over the index columns, nothing is parsed
+	std::chrono::steady_clock::time_point t1{ std::chrono::steady_clock::now() };
+	std::vector<uint64_t> games;
+	uint64_t score{}, nrPieces{}, nrLines{}, nrSteps{}, nrGameOvers{};
+	for (uint64_t i = 0; i < corpus.nrGames; i++)
+	{
+		uint32_t gameScore{ corpus.pScores[i] };
+		if (gameScore < settings.minScore || gameScore > settings.maxScore || corpus.pPieces[i] < settings.minPieces
+			|| (settings.isGameOverOnly && corpus.pGameOvers[i] == 0))
+		{
+			continue;
+		}
+		games.push_back(i);
+		score += gameScore;
+		nrPieces += corpus.pPieces[i];
+		nrLines += corpus.pLines[i];
+		nrSteps += corpus.pEndSteps[i];
+		nrGameOvers += corpus.pGameOvers[i];
+	}
+	float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - t1).count() };
+	// The score, pieces, lines and end step columns and the game over flags
+	double indexMegabytes{ corpus.nrGames * (4 * sizeof(uint32_t) + sizeof(uint8_t)) / 1e6 };
+
+	double nrSelected{ games.empty() ? 1.0 : double(games.size()) };
+	printf("games       %llu of %llu, %.1f MB of events\n", (unsigned long long)games.size(), (unsigned long long)corpus.nrGames, corpus.eventBytes / 1e6);
+	printf("index scan  %.3f ms, %.0f MB/s\n", seconds * 1000.f, indexMegabytes / seconds);
+	printf("mean score  %.1f\n", score / nrSelected);
+	printf("mean lines  %.2f\n", nrLines / nrSelected);
+	printf("mean pieces %.1f\n", nrPieces / nrSelected);
+	printf("survival    %.1f s on average, %.1f%% topped out\n", nrSteps / nrSelected / g_StepsPerSecond, 100.0 * nrGameOvers / nrSelected);
+
+	int result{ 0 };
+	if (settings.isResim && !games.empty())
+	{
+		int nrThreads{ settings.nrThreads < 1 ? 1 : settings.nrThreads };
+		std::vector<ResimStats> stats(nrThreads);
+		std::atomic<uint64_t> next{};
+		t1 = std::chrono::steady_clock::now();
+		std::vector<std::thread> workers;
+		for (int i = 1; i < nrThreads; i++)
+		{
+			workers.emplace_back(RunResim, std::cref(corpus), std::cref(games), std::ref(next), std::ref(stats[i]));
+		}
+		RunResim(corpus, games, next, stats[0]);
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - t1).count();
+
+		ResimStats total{};
+		for (const ResimStats& worker : stats)
+		{
+			total.nrGames += worker.nrGames;
+			total.nrSteps += worker.nrSteps;
+			total.nrEventBytes += worker.nrEventBytes;
+			for (int i = 0; i < 4; i++)
+			{
+				total.clears[i] += worker.clears[i];
+			}
+			total.nrMismatches += worker.nrMismatches;
+			total.nrInvalid += worker.nrInvalid;
+		}
+		uint64_t nrClears{ total.clears[0] + total.clears[1] + total.clears[2] + total.clears[3] };
+		double clearShare{ nrClears > 0 ? 100.0 / nrClears : 0.0 };
+		printf("resim       %llu games on %d threads in %.3f s, %.0f games/s, %.0f M steps/s, %.1f MB/s of events\n",
+			(unsigned long long)total.nrGames, nrThreads, seconds, total.nrGames / seconds, total.nrSteps / seconds / 1e6, total.nrEventBytes / seconds / 1e6);
+		printf("clears      %.1f%% single, %.1f%% double, %.1f%% triple, %.1f%% tetris\n",
+			total.clears[0] * clearShare, total.clears[1] * clearShare, total.clears[2] * clearShare, total.clears[3] * clearShare);
+		printf("mismatches  %llu\n", (unsigned long long)total.nrMismatches);
+		printf("invalid     %llu skipped\n", (unsigned long long)total.nrInvalid);
+		result = total.nrMismatches == 0 && total.nrInvalid == 0 ? 0 : 2;
+	}
+	CloseCorpus(corpus);
+	return result;
+}
+
+void RunResim(const Corpus& corpus, const std::vector<uint64_t>& games, std::atomic<uint64_t>& next, ResimStats& stats)
+{
+	ReplayPlayer player{};
+	while (true)
+	{
+		uint64_t first{ next.fetch_add(g_ResimChunk, std::memory_order_relaxed) };
+		if (first >= games.size())
+		{
+			return;
+		}
+		uint64_t end{ first + g_ResimChunk < games.size() ? first + g_ResimChunk : games.size() };
+		for (uint64_t i = first; i < end; i++)
+		{
+			// The events are read where they are in the mapping
+			uint64_t game{ games[i] };
+			ReplayView replay{};
+			if (!GetCorpusReplay(corpus, game, replay))
+			{
+				stats.nrInvalid++;
+				continue;
+			}
+			StartPlayback(player, replay);
+			PlayReplay(player, replay.endStep);
+			if (player.position.isBroken)
+			{
+				stats.nrInvalid++;
+				continue;
+			}
+
+			const GameState& state{ player.position.state };
+			stats.nrGames++;
+			stats.nrSteps += uint32_t(state.counter);
+			stats.nrEventBytes += replay.nrBytes;
+			for (int j = 0; j < 4; j++)
+			{
+				stats.clears[j] += state.clears[j];
+			}
+			stats.nrMismatches += MatchesRecording(GetCorpusHeader(corpus, game), state) ? 0 : 1;
+		}
+	}
+}
@@ -0,0 +1,278 @@
+#include "TetrisEnv.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "GameState.h"
+
+static_assert(TETRIS_ENV_ROWS == g_BoardRows && TETRIS_ENV_COLUMNS == g_BoardWidth && TETRIS_ENV_QUEUE == g_QueueLength,
+	"the observation layout in TetrisEnv.h follows the board");
+static_assert(g_BoardWidth % 5 == 0, "rows are spread 5 cells at a time");
+
+const uint8_t g_ActionMask{ InputLeft | InputRight | InputRotateCW | InputRotateCCW | InputHardDrop };
+const int g_BoardCells{ g_BoardRows * g_BoardWidth };
+// Environments a worker takes at a time, enough to make taking them cheap and few enough to share a batch out
+const int g_ChunkSize{ 64 };
+// Batches follow each other closely during training, so a worker checks for the next one this often before it sleeps
+const int g_SpinRounds{ 2000 };
+
+enum class EnvJob
+{
+	Reset, Step
+};
+
+// The calling thread and the workers take chunks of the batch until none are left. A worker that is late for a batch
+// and takes a chunk of the next one does that chunk of the next one, so nobody needs to know which batch it's in.
+struct TetrisEnv
+{
+	std::vector<GameState> games;
+	std::vector<uint64_t> seeds; // of the games being played
+	int nrEnvs;
+
+	// The batch being worked on, written before chunksLeft is
+	EnvJob job;
+	const uint8_t* pActions;
+	uint8_t* pObservations;
+	float* pRewards;
+	uint8_t* pDones;
+	int nrChunks;
+	alignas(64) std::atomic<int> chunksLeft;
+	alignas(64) std::atomic<int> nrChunksDone;
+
+	// Workers wait for the generation to change, one per batch
+	alignas(64) std::atomic<uint64_t> generation;
+	std::atomic<bool> isStopping;
+	std::mutex mutex;
+	std::condition_variable wake;
+	int nrSleeping; // workers waiting on wake, under the mutex
+	std::vector<std::thread> workers;
+};
+
+void RunEnvWorker(TetrisEnv* pEnv);
+bool WaitForBatch(TetrisEnv& env, uint64_t& seen);
+void RunBatch(TetrisEnv& env, EnvJob job);
+void RunChunks(TetrisEnv& env);
+void StartGame(GameState& game, uint64_t seed);
+void WriteObservation(const GameState& game, uint8_t* pObservation);
+
+// 5 bits of a row as one byte per cell
+struct CellBytes
+{
+	uint8_t cells[5];
+};
+
+constexpr CellBytes MakeCellBytes(int bits)
+{
+	CellBytes bytes{};
+	for (int i = 0; i < 5; i++)
+	{
+		bytes.cells[i] = uint8_t((bits >> i) & 1);
+	}
+	return bytes;
+}
+
+constexpr CellBytes g_CellBytes[32]{
+	MakeCellBytes(0), MakeCellBytes(1), MakeCellBytes(2), MakeCellBytes(3), MakeCellBytes(4), MakeCellBytes(5), MakeCellBytes(6), MakeCellBytes(7),
+	MakeCellBytes(8), MakeCellBytes(9), MakeCellBytes(10), MakeCellBytes(11), MakeCellBytes(12), MakeCellBytes(13), MakeCellBytes(14), MakeCellBytes(15),
+	MakeCellBytes(16), MakeCellBytes(17), MakeCellBytes(18), MakeCellBytes(19), MakeCellBytes(20), MakeCellBytes(21), MakeCellBytes(22), MakeCellBytes(23),
+	MakeCellBytes(24), MakeCellBytes(25), MakeCellBytes(26), MakeCellBytes(27), MakeCellBytes(28), MakeCellBytes(29), MakeCellBytes(30), MakeCellBytes(31)
+};
+
+TetrisEnv* TetrisEnvCreate(int nrThreads)
+{
+	TetrisEnv* pEnv{ new TetrisEnv{} };
+	pEnv->nrEnvs = 0;
+	pEnv->chunksLeft.store(0);
+	pEnv->nrChunksDone.store(0);
+	pEnv->generation.store(0);
+	pEnv->isStopping.store(false);
+	pEnv->nrSleeping = 0;
+	if (nrThreads <= 0)
+	{
+		nrThreads = int(std::thread::hardware_concurrency());
+	}
+	for (int i = 1; i < nrThreads; i++)
+	{
+		pEnv->workers.emplace_back(RunEnvWorker, pEnv);
+	}
+	return pEnv;
+}
+
+void TetrisEnvDestroy(TetrisEnv* pEnv)
+{
+	if (!pEnv)
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock{ pEnv->mutex };
+		pEnv->isStopping.store(true);
+		pEnv->generation.fetch_add(1);
+	}
+	pEnv->wake.notify_all();
+	for (std::thread& worker : pEnv->workers)
+	{
+		worker.join();
+	}
+	delete pEnv;
+}
+
+int TetrisEnvReset(TetrisEnv* pEnv, int nrEnvs, const uint64_t* pSeeds, uint8_t* pObservations)
+{
+	if (!pEnv || nrEnvs <= 0 || !pSeeds || !pObservations)
+	{
+		return -1;
+	}
+	pEnv->nrEnvs = nrEnvs;
+	pEnv->games.resize(nrEnvs);
+	pEnv->seeds.assign(pSeeds, pSeeds + nrEnvs);
+	pEnv->pObservations = pObservations;
+	RunBatch(*pEnv, EnvJob::Reset);
+	return 0;
+}
+
+int TetrisEnvStep(TetrisEnv* pEnv, const uint8_t* pActions, uint8_t* pObservations, float* pRewards, uint8_t* pDones)
+{
+	if (!pEnv || pEnv->nrEnvs == 0 || !pActions || !pObservations || !pRewards || !pDones)
+	{
+		return -1;
+	}
+	pEnv->pActions = pActions;
+	pEnv->pObservations = pObservations;
+	pEnv->pRewards = pRewards;
+	pEnv->pDones = pDones;
+	RunBatch(*pEnv, EnvJob::Step);
+	return 0;
+}
+
+int TetrisEnvObservationSize(void)
+{
+	return TETRIS_ENV_OBSERVATION_SIZE;
+}
+
+void RunEnvWorker(TetrisEnv* pEnv)
+{
+	uint64_t seen{};
+	while (WaitForBatch(*pEnv, seen))
+	{
+		RunChunks(*pEnv);
+	}
+}
+
+bool WaitForBatch(TetrisEnv& env, uint64_t& seen)
+{
+	for (int i = 0; i < g_SpinRounds; i++)
+	{
+		uint64_t generation{ env.generation.load(std::memory_order_acquire) };
+		if (generation != seen)
+		{
+			seen = generation;
+			return !env.isStopping.load(std::memory_order_relaxed);
+		}
+		std::this_thread::yield();
+	}
+	std::unique_lock<std::mutex> lock{ env.mutex };
+	env.nrSleeping++;
+	env.wake.wait(lock, [&] { return env.generation.load(std::memory_order_relaxed) != seen; });
+	env.nrSleeping--;
+	seen = env.generation.load(std::memory_order_relaxed);
+	return !env.isStopping.load(std::memory_order_relaxed);
+}
+
+void RunBatch(TetrisEnv& env, EnvJob job)
+{
+	env.job = job;
+	env.nrChunks = (env.nrEnvs + g_ChunkSize - 1) / g_ChunkSize;
+	env.nrChunksDone.store(0, std::memory_order_relaxed);
+	env.chunksLeft.store(env.nrChunks, std::memory_order_release);
+	if (!env.workers.empty())
+	{
+		// Waking a worker costs a system call, the ones still spinning see the generation change by themselves
+		bool isAnyoneSleeping{};
+		{
+			std::lock_guard<std::mutex> lock{ env.mutex };
+			env.generation.fetch_add(1, std::memory_order_release);
+			isAnyoneSleeping = env.nrSleeping > 0;
+		}
+		if (isAnyoneSleeping)
+		{
+			env.wake.notify_all();
+		}
+	}
+	RunChunks(env);
+	while (env.nrChunksDone.load(std::memory_order_acquire) < env.nrChunks)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void RunChunks(TetrisEnv& env)
+{
+	int chunk{};
+	while ((chunk = env.chunksLeft.fetch_sub(1, std::memory_order_acq_rel) - 1) >= 0)
+	{
+		int first{ chunk * g_ChunkSize };
+		int end{ first + g_ChunkSize < env.nrEnvs ? first + g_ChunkSize : env.nrEnvs };
+		for (int i = first; i < end; i++)
+		{
+			GameState& game{ env.games[i] };
+			if (env.job == EnvJob::Reset)
+			{
+				StartGame(game, env.seeds[i]);
+			}
+			else
+			{
+				int score{ game.score };
+				Step(game, env.pActions[i] & g_ActionMask);
+				env.pRewards[i] = float(game.score - score);
+				env.pDones[i] = game.isGameOver ? 1 : 0;
+				if (game.isGameOver)
+				{
+					env.seeds[i] += uint64_t(env.nrEnvs);
+					StartGame(game, env.seeds[i]);
+				}
+			}
+			WriteObservation(game, env.pObservations + size_t(i) * TETRIS_ENV_OBSERVATION_SIZE);
+		}
+		env.nrChunksDone.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void StartGame(GameState& game, uint64_t seed)
+{
+	NewGame(game, seed);
+	Step(game, InputNone);
+}
+
+void WriteObservation(const GameState& game, uint8_t* pObservation)
+{
+	uint8_t* pLocked{ pObservation };
+	for (int row = 0; row < g_BoardRows; row++)
+	{
+		for (int col = 0; col < g_BoardWidth; col += 5)
+		{
+			std::memcpy(pLocked + row * g_BoardWidth + col, g_CellBytes[(game.board.filled[row] >> col) & 31].cells, 5);
+		}
+	}
+
+	uint8_t* pPiece{ pObservation + g_BoardCells };
+	std::memset(pPiece, 0, g_BoardCells);
+	if (game.isMoving)
+	{
+		for (const PieceCell& cell : GetPieceMask(game.figure, game.rotation).cells)
+		{
+			int col{ game.x + cell.x };
+			int row{ game.y + cell.y };
+			if (unsigned(col) < unsigned(g_BoardWidth) && unsigned(row) < unsigned(g_BoardRows))
+			{
+				pPiece[row * g_BoardWidth + col] = 1;
+			}
+		}
+	}
+
+	uint8_t* pQueue{ pPiece + g_BoardCells };
+	pQueue[0] = uint8_t(game.isMoving ? game.figure : g_NrBlockTypes);
+	std::memcpy(pQueue + 1, game.queue, g_QueueLength);
+}
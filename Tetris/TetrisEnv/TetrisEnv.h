@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+
+// Vectorized environment for reinforcement learning: a batch of headless games stepped together, in parallel.
+// C functions only, so the shared library loads from Python with ctypes or from any other language.
+// Every action is the input flags of one simulation step: left 1, right 2, rotate clockwise 4,
+// rotate counterclockwise 8 and hard drop 16, combined. Nothing is allocated after the reset,
+// the observations, rewards and dones go straight into the buffers the caller passes.
+//
+// The observation of one environment is TETRIS_ENV_OBSERVATION_SIZE bytes:
+//   the locked cells, TETRIS_ENV_ROWS rows of TETRIS_ENV_COLUMNS bytes that are 0 or 1, bottom row first
+//   the cells of the moving piece, laid out the same
+//   the moving piece, then the TETRIS_ENV_QUEUE pieces after it, 0 to 6, the moving piece is 7 while there is none
+// The observations of the batch follow each other in one buffer.
+//
+// A game that ends is started again right away with its next seed, its done is 1 and its observation is the
+// first of the new game. Environment i plays seeds[i], then seeds[i] + nrEnvs, seeds[i] + 2 * nrEnvs and so on.
+// A new game takes its first step without input, so there is always a piece to move.
+#define TETRIS_ENV_ROWS 20
+#define TETRIS_ENV_COLUMNS 10
+#define TETRIS_ENV_QUEUE 6
+#define TETRIS_ENV_OBSERVATION_SIZE (2 * TETRIS_ENV_ROWS * TETRIS_ENV_COLUMNS + 1 + TETRIS_ENV_QUEUE)
+
+#ifdef _WIN32
+#define TETRIS_ENV_API __declspec(dllexport)
+#else
+#define TETRIS_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TetrisEnv TetrisEnv;
+
+// nrThreads 0 uses every core, the calling thread is one of them
+TETRIS_ENV_API TetrisEnv* TetrisEnvCreate(int nrThreads);
+TETRIS_ENV_API void TetrisEnvDestroy(TetrisEnv* pEnv);
+// Starts nrEnvs games, the only call that allocates. Returns 0, or -1 when nrEnvs isn't positive or a pointer is null.
+TETRIS_ENV_API int TetrisEnvReset(TetrisEnv* pEnv, int nrEnvs, const uint64_t* pSeeds, uint8_t* pObservations);
+// One step of every game with its action. The reward is the score the step made, the points for the lines cleared.
+// Returns 0, or -1 before the first reset or when a pointer is null.
+TETRIS_ENV_API int TetrisEnvStep(TetrisEnv* pEnv, const uint8_t* pActions, uint8_t* pObservations, float* pRewards, uint8_t* pDones);
+TETRIS_ENV_API int TetrisEnvObservationSize(void);
+
+#ifdef __cplusplus
+}
+#endif
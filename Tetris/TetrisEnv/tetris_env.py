@@ -0,0 +1,108 @@
+"""Vectorized Tetris environment on the tetris_env shared library, see TetrisEnv.h for the layout.
+
+    env = VectorEnv(4096)
+    observations = env.reset(range(4096))
+    observations, rewards, dones = env.step(actions)
+
+The buffers are made once and every call fills them in place. With numpy they are numpy arrays, observations
+(n_envs, OBSERVATION_SIZE) uint8, rewards float32 and dones uint8, without it ctypes arrays.
+The library is looked up next to this file, or wherever TETRIS_ENV_LIBRARY points.
+"""
+import ctypes
+import os
+import sys
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+ROWS = 20
+COLUMNS = 10
+QUEUE = 6
+OBSERVATION_SIZE = 2 * ROWS * COLUMNS + 1 + QUEUE
+NO_PIECE = 7
+
+LEFT, RIGHT, ROTATE_CW, ROTATE_CCW, HARD_DROP = 1, 2, 4, 8, 16
+
+
+def load_library(path=None):
+    if path is None:
+        name = {"win32": "tetris_env.dll", "darwin": "libtetris_env.dylib"}.get(sys.platform, "libtetris_env.so")
+        path = os.environ.get("TETRIS_ENV_LIBRARY", os.path.join(os.path.dirname(os.path.abspath(__file__)), name))
+    library = ctypes.CDLL(path)
+    library.TetrisEnvCreate.restype = ctypes.c_void_p
+    library.TetrisEnvCreate.argtypes = [ctypes.c_int]
+    library.TetrisEnvDestroy.restype = None
+    library.TetrisEnvDestroy.argtypes = [ctypes.c_void_p]
+    library.TetrisEnvReset.restype = ctypes.c_int
+    library.TetrisEnvReset.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p]
+    library.TetrisEnvStep.restype = ctypes.c_int
+    library.TetrisEnvStep.argtypes = [ctypes.c_void_p] + [ctypes.c_void_p] * 4
+    library.TetrisEnvObservationSize.restype = ctypes.c_int
+    if library.TetrisEnvObservationSize() != OBSERVATION_SIZE:
+        raise RuntimeError("tetris_env was built for a different observation layout")
+    return library
+
+
+def _make_buffer(ctype, dtype, shape):
+    size = 1
+    for length in shape:
+        size *= length
+    if numpy is not None:
+        array = numpy.zeros(shape, dtype=dtype)
+        return array, array.ctypes.data
+    array = (ctype * size)()
+    return array, ctypes.addressof(array)
+
+
+class VectorEnv:
+    def __init__(self, n_envs, threads=0, library_path=None):
+        self._library = load_library(library_path)
+        self.n_envs = n_envs
+        self.observations, self._observations = _make_buffer(ctypes.c_uint8, "uint8", (n_envs, OBSERVATION_SIZE))
+        self.rewards, self._rewards = _make_buffer(ctypes.c_float, "float32", (n_envs,))
+        self.dones, self._dones = _make_buffer(ctypes.c_uint8, "uint8", (n_envs,))
+        self.actions, self._actions = _make_buffer(ctypes.c_uint8, "uint8", (n_envs,))
+        self.seeds, self._seeds = _make_buffer(ctypes.c_uint64, "uint64", (n_envs,))
+        self._env = self._library.TetrisEnvCreate(threads)
+
+    def reset(self, seeds):
+        self.seeds[:] = list(seeds) if numpy is None else seeds
+        if self._library.TetrisEnvReset(self._env, self.n_envs, self._seeds, self._observations) != 0:
+            raise RuntimeError("reset needs at least one env and an env that isn't closed")
+        return self.observations
+
+    def step(self, actions):
+        # Copied into the buffer the library reads, unless they already are that buffer
+        if actions is not self.actions:
+            self.actions[:] = list(actions) if numpy is None else actions
+        if self._library.TetrisEnvStep(self._env, self._actions, self._observations, self._rewards, self._dones) != 0:
+            raise RuntimeError("step before reset or after close")
+        return self.observations, self.rewards, self.dones
+
+    def close(self):
+        if self._env:
+            self._library.TetrisEnvDestroy(self._env)
+            self._env = None
+
+    def __del__(self):
+        self.close()
+
+
+if __name__ == "__main__":
+    import random
+    import time
+
+    n_envs = int(sys.argv[1]) if len(sys.argv) > 1 else 4096
+    env = VectorEnv(n_envs)
+    env.reset(range(n_envs))
+    for i in range(n_envs):
+        env.actions[i] = random.choice([0, 0, 0, LEFT, RIGHT, ROTATE_CW, HARD_DROP])
+    nr_steps = 200
+    start = time.perf_counter()
+    for _ in range(nr_steps):
+        env.step(env.actions)
+    seconds = time.perf_counter() - start
+    print("%d envs, %.0f env steps/s" % (n_envs, n_envs * nr_steps / seconds))
+    env.close()
@@ -0,0 +1,114 @@
+#include "Socket.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+int OpenSocket(const Address& address, bool isListening);
+
+bool ParseAddress(const char* pText, Address& address)
+{
+	if (strncmp(pText, "unix:", 5) == 0)
+	{
+		address = Address{ true, pText + 5, 0 };
+		return address.host.size() < sizeof(sockaddr_un::sun_path);
+	}
+	const char* pColon{ strrchr(pText, ':') };
+	if (!pColon)
+	{
+		return false;
+	}
+	address = Address{ false, std::string{ pText, pColon }, atoi(pColon + 1) };
+	return address.port > 0 && address.port < 65536;
+}
+
+int Listen(const Address& address)
+{
+	return OpenSocket(address, true);
+}
+
+int Connect(const Address& address)
+{
+	return OpenSocket(address, false);
+}
+
+int OpenSocket(const Address& address, bool isListening)
+{
+	const char* pWhat{ isListening ? "listen on" : "connect to" };
+	int fd{ -1 };
+	int result{ -1 };
+	if (address.isUnix)
+	{
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un name{};
+		name.sun_family = AF_UNIX;
+		strcpy(name.sun_path, address.host.c_str());
+		if (fd >= 0 && isListening)
+		{
+			// A socket file left behind by a server that was killed would block the bind
+			unlink(name.sun_path);
+			result = bind(fd, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+		}
+		else if (fd >= 0)
+		{
+			result = connect(fd, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+		}
+	}
+	else
+	{
+		addrinfo hints{};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = isListening ? AI_PASSIVE : 0;
+		addrinfo* pInfo{};
+		std::string port{ std::to_string(address.port) };
+		if (getaddrinfo(address.host.empty() ? nullptr : address.host.c_str(), port.c_str(), &hints, &pInfo) != 0)
+		{
+			printf("could not %s %s:%d, unknown host\n", pWhat, address.host.c_str(), address.port);
+			return -1;
+		}
+		fd = socket(pInfo->ai_family, pInfo->ai_socktype, pInfo->ai_protocol);
+		int on{ 1 };
+		if (fd >= 0 && isListening)
+		{
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+			result = bind(fd, pInfo->ai_addr, pInfo->ai_addrlen);
+		}
+		else if (fd >= 0)
+		{
+			result = connect(fd, pInfo->ai_addr, pInfo->ai_addrlen);
+		}
+		// Every tick is one small message that is waited for, so nothing may hold it back to fill a packet
+		if (fd >= 0)
+		{
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		}
+		freeaddrinfo(pInfo);
+	}
+
+	if (result == 0 && isListening)
+	{
+		result = listen(fd, SOMAXCONN);
+	}
+	if (result == 0)
+	{
+		result = fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	}
+	if (result != 0)
+	{
+		printf("could not %s %s: %s\n", pWhat, address.isUnix ? address.host.c_str() : (address.host + ":" + std::to_string(address.port)).c_str(), strerror(errno));
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		return -1;
+	}
+	return fd;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Where the server listens and the clients connect: host:port for TCP, unix:path for a Unix socket
+struct Address
+{
+	bool isUnix;
+	std::string host; // or the path
+	int port;
+};
+
+bool ParseAddress(const char* pText, Address& address);
+// Both return a non-blocking socket, or -1 with the reason printed
+int Listen(const Address& address);
+int Connect(const Address& address);
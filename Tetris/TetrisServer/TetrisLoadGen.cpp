@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "MatchProtocol.h"
+#include "Socket.h"
+
+// Plays many games on a match server over a few connections and measures how fast the server ticks them.
+// Every connection sends a tick with random input for its games, waits for the deltas and sends the next one,
+// so the ticks per second are what the server keeps up with and the latency is the round trip of one tick.
+// Games that end are started again with a new seed. With --verify every game is also played here and
+// what the deltas built up has to match it after every tick.
+using Clock = std::chrono::steady_clock;
+
+struct LoadSettings
+{
+	Address address;
+	uint32_t nrGames;
+	int nrConnections;
+	int nrThreads;
+	float seconds;
+	uint64_t firstSeed;
+	bool isVerifying;
+};
+
+struct Client
+{
+	int fd;
+	uint64_t nextSeed;
+	uint32_t tick;
+	Clock::time_point sentAt;
+	std::vector<GameSnapshot> seen; // what the deltas said so far
+	std::vector<GameState> games; // the same games played here, only when verifying
+	std::vector<uint8_t> inputs; // of the tick in flight
+	Random player;
+	std::vector<uint8_t> input;
+	std::vector<uint8_t> output;
+	size_t outputSent;
+	bool isWaitingToWrite; // for the socket to take the rest of the output
+};
+
+// Every thread only writes its own stats, they are added up after all threads are done
+struct alignas(64) ThreadStats
+{
+	uint64_t nrTicks;
+	uint64_t nrGameTicks;
+	uint64_t bytesReceived;
+	uint64_t nrRestarts;
+	uint64_t nrMismatches;
+	bool hasFailed;
+	std::vector<float> latencies; // ms, of the ticks after the warm up
+	Clock::time_point firstAnswer, lastAnswer; // of the measured ticks, the throughput is over the time between them
+};
+
+// The first ticks start every game and send whole boards, they aren't measured
+const float g_WarmUpSeconds{ 1.f };
+const size_t g_ReadSize{ 64 * 1024 };
+
+void PrintUsage();
+bool ParseArguments(int argc, char* args[], LoadSettings& settings);
+void RunThread(const LoadSettings& settings, int firstClient, int endClient, Clock::time_point start, ThreadStats& stats);
+void SendTick(Client& client, bool isVerifying, ThreadStats& stats);
+bool Receive(Client& client, bool isVerifying, bool isMeasuring, ThreadStats& stats, bool& isAnswered);
+bool Flush(int epollFd, Client& client);
+float Percentile(std::vector<float>& values, float fraction);
+
+int main(int argc, char* args[])
+{
+	LoadSettings settings{ Address{ false, "127.0.0.1", g_DefaultPort }, 10000, 16, 1, 10.f, 0, false };
+	if (!ParseArguments(argc, args, settings))
+	{
+		PrintUsage();
+		return 1;
+	}
+	settings.nrConnections = std::max(1, std::min(settings.nrConnections, int(settings.nrGames)));
+	settings.nrThreads = std::max(1, std::min(settings.nrThreads, settings.nrConnections));
+	if ((settings.nrGames + settings.nrConnections - 1) / settings.nrConnections > uint32_t(g_MaxGamesPerConnection))
+	{
+		printf("at most %d games per connection\n", g_MaxGamesPerConnection);
+		return 1;
+	}
+
+	Clock::time_point start{ Clock::now() };
+	std::vector<ThreadStats> stats(settings.nrThreads);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < settings.nrThreads; i++)
+	{
+		int firstClient{ settings.nrConnections * i / settings.nrThreads };
+		int endClient{ settings.nrConnections * (i + 1) / settings.nrThreads };
+		threads.emplace_back(RunThread, std::cref(settings), firstClient, endClient, start, std::ref(stats[i]));
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	ThreadStats total{};
+	total.firstAnswer = Clock::time_point::max();
+	total.lastAnswer = Clock::time_point::min();
+	for (ThreadStats& thread : stats)
+	{
+		if (thread.nrTicks > 0)
+		{
+			total.firstAnswer = std::min(total.firstAnswer, thread.firstAnswer);
+			total.lastAnswer = std::max(total.lastAnswer, thread.lastAnswer);
+		}
+		total.nrTicks += thread.nrTicks;
+		total.nrGameTicks += thread.nrGameTicks;
+		total.bytesReceived += thread.bytesReceived;
+		total.nrRestarts += thread.nrRestarts;
+		total.nrMismatches += thread.nrMismatches;
+		total.hasFailed |= thread.hasFailed;
+		total.latencies.insert(total.latencies.end(), thread.latencies.begin(), thread.latencies.end());
+	}
+	if (total.hasFailed)
+	{
+		return 1;
+	}
+
+	// Measured, so connecting, the warm up and the last answers coming in don't count
+	float seconds{ total.nrTicks > 1 ? std::chrono::duration<float>(total.lastAnswer - total.firstAnswer).count() : 0.f };
+	seconds = seconds > 0.f ? seconds : settings.seconds;
+	printf("games       %u over %d connections on %d threads\n", settings.nrGames, settings.nrConnections, settings.nrThreads);
+	printf("ticks       %llu in %.1f s, %.0f ticks/s\n", (unsigned long long)total.nrTicks, seconds, total.nrTicks / seconds);
+	printf("game ticks  %.0f/s, %.1f ticks/s per game\n", total.nrGameTicks / seconds, total.nrGameTicks / seconds / settings.nrGames);
+	if (!total.latencies.empty())
+	{
+		printf("latency     p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", Percentile(total.latencies, 0.5f), Percentile(total.latencies, 0.99f),
+			Percentile(total.latencies, 1.f));
+	}
+	printf("received    %.2f bytes per game tick\n", total.nrGameTicks > 0 ? double(total.bytesReceived) / total.nrGameTicks : 0.0);
+	printf("restarts    %llu\n", (unsigned long long)total.nrRestarts);
+	if (settings.isVerifying)
+	{
+		printf("verified    %s\n", total.nrMismatches == 0 ? "every game matches" : (std::to_string(total.nrMismatches) + " MISMATCHES").c_str());
+	}
+	return total.nrMismatches == 0 ? 0 : 2;
+}
+
+void PrintUsage()
+{
+	printf("usage: tetris_loadgen [--connect host:port|unix:path] [--games n] [--connections n] [--threads n] [--seconds s] [--seed n] [--verify]\n");
+}
+
+bool ParseArguments(int argc, char* args[], LoadSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--connect") == 0 && i + 1 < argc)
+		{
+			if (!ParseAddress(args[++i], settings.address))
+			{
+				return false;
+			}
+		}
+		else if (strcmp(args[i], "--games") == 0 && i + 1 < argc)
+		{
+			settings.nrGames = uint32_t(strtoul(args[++i], nullptr, 10));
+		}
+		else if (strcmp(args[i], "--connections") == 0 && i + 1 < argc)
+		{
+			settings.nrConnections = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+		{
+			settings.nrThreads = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "--seconds") == 0 && i + 1 < argc)
+		{
+			settings.seconds = float(atof(args[++i]));
+		}
+		else if (strcmp(args[i], "--seed") == 0 && i + 1 < argc)
+		{
+			settings.firstSeed = strtoull(args[++i], nullptr, 10);
+		}
+		else if (strcmp(args[i], "--verify") == 0)
+		{
+			settings.isVerifying = true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return settings.nrGames > 0 && settings.seconds > 0.f;
+}
+
+void RunThread(const LoadSettings& settings, int firstClient, int endClient, Clock::time_point start, ThreadStats& stats)
+{
+	int epollFd{ epoll_create1(0) };
+	std::vector<Client> clients(endClient - firstClient);
+	for (Client& client : clients)
+	{
+		client.fd = -1;
+	}
+	for (int i = firstClient; i < endClient; i++)
+	{
+		Client& client{ clients[i - firstClient] };
+		client.fd = Connect(settings.address);
+		if (client.fd < 0)
+		{
+			stats.hasFailed = true;
+			break;
+		}
+		uint32_t firstGame{ uint32_t(uint64_t(settings.nrGames) * i / settings.nrConnections) };
+		uint32_t endGame{ uint32_t(uint64_t(settings.nrGames) * (i + 1) / settings.nrConnections) };
+		uint32_t nrGames{ endGame - firstGame };
+		// Every connection draws its restart seeds from its own range
+		client.nextSeed = settings.firstSeed + (uint64_t(i) << 32);
+		client.tick = 0;
+		client.seen.resize(nrGames);
+		client.games.resize(settings.isVerifying ? nrGames : 0);
+		client.inputs.resize(nrGames);
+		SeedRandom(client.player, ~client.nextSeed);
+		client.outputSent = 0;
+		client.isWaitingToWrite = false;
+		epoll_event event{};
+		event.events = EPOLLIN | EPOLLRDHUP;
+		event.data.ptr = &client;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+
+		size_t message{ StartMessage(client.output, MessageType::NewGames) };
+		for (uint32_t j = 0; j < nrGames; j++)
+		{
+			uint64_t seed{ client.nextSeed++ };
+			PutNewGame(client.output, uint16_t(j), seed);
+			client.seen[j] = GameSnapshot{};
+			if (settings.isVerifying)
+			{
+				NewGame(client.games[j], seed);
+			}
+		}
+		EndMessage(client.output, message);
+		SendTick(client, settings.isVerifying, stats);
+		if (!Flush(epollFd, client))
+		{
+			stats.hasFailed = true;
+			break;
+		}
+	}
+
+	Clock::time_point measureStart{ start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(g_WarmUpSeconds)) };
+	Clock::time_point end{ measureStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(settings.seconds)) };
+	stats.latencies.reserve(1 << 20);
+	const int maxEvents{ 64 };
+	epoll_event events[maxEvents];
+	int nrWaiting{ stats.hasFailed ? 0 : int(clients.size()) };
+	while (nrWaiting > 0)
+	{
+		int nrEvents{ epoll_wait(epollFd, events, maxEvents, 100) };
+		Clock::time_point now{ Clock::now() };
+		bool isMeasuring{ now >= measureStart && now < end };
+		for (int i = 0; i < nrEvents; i++)
+		{
+			Client& client{ *static_cast<Client*>(events[i].data.ptr) };
+			bool isAnswered{};
+			if (!Receive(client, settings.isVerifying, isMeasuring, stats, isAnswered) || !Flush(epollFd, client))
+			{
+				printf("lost the connection to the server\n");
+				stats.hasFailed = true;
+				nrWaiting = 0;
+				break;
+			}
+			if (!isAnswered)
+			{
+				continue;
+			}
+			// After the end the last tick is in, the connection is done
+			if (now >= end)
+			{
+				epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+				nrWaiting--;
+				continue;
+			}
+			SendTick(client, settings.isVerifying, stats);
+			if (!Flush(epollFd, client))
+			{
+				stats.hasFailed = true;
+				nrWaiting = 0;
+				break;
+			}
+		}
+	}
+
+	for (Client& client : clients)
+	{
+		if (client.fd >= 0)
+		{
+			close(client.fd);
+		}
+	}
+	close(epollFd);
+}
+
+void SendTick(Client& client, bool isVerifying, ThreadStats& stats)
+{
+	// Games that ended in the last tick start again first, in the same write as the tick
+	size_t message{};
+	bool hasRestarts{};
+	for (size_t i = 0; i < client.seen.size(); i++)
+	{
+		if (!(client.seen[i].piece & g_PieceGameOver))
+		{
+			continue;
+		}
+		if (!hasRestarts)
+		{
+			message = StartMessage(client.output, MessageType::NewGames);
+			hasRestarts = true;
+		}
+		uint64_t seed{ client.nextSeed++ };
+		PutNewGame(client.output, uint16_t(i), seed);
+		client.seen[i] = GameSnapshot{};
+		if (isVerifying)
+		{
+			NewGame(client.games[i], seed);
+		}
+		stats.nrRestarts++;
+	}
+	if (hasRestarts)
+	{
+		EndMessage(client.output, message);
+	}
+
+	// A player that mashes keys, now and then
+	client.tick++;
+	message = StartMessage(client.output, MessageType::Tick);
+	Put(client.output, client.tick);
+	for (size_t i = 0; i < client.seen.size(); i++)
+	{
+		const uint8_t keys[5]{ InputLeft, InputRight, InputRotateCW, InputRotateCCW, InputHardDrop };
+		uint32_t roll{ RandomBelow(client.player, 32) };
+		client.inputs[i] = roll < 5 ? keys[roll] : uint8_t(InputNone);
+		if (client.inputs[i] != InputNone)
+		{
+			PutInput(client.output, uint16_t(i), client.inputs[i]);
+		}
+	}
+	EndMessage(client.output, message);
+	client.sentAt = Clock::now();
+}
+
+bool Receive(Client& client, bool isVerifying, bool isMeasuring, ThreadStats& stats, bool& isAnswered)
+{
+	std::vector<uint8_t>& input{ client.input };
+	while (true)
+	{
+		size_t size{ input.size() };
+		input.resize(size + g_ReadSize);
+		ssize_t nrRead{ recv(client.fd, &input[size], g_ReadSize, 0) };
+		input.resize(size + (nrRead > 0 ? size_t(nrRead) : 0));
+		if (nrRead == 0)
+		{
+			return false;
+		}
+		if (nrRead < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				return false;
+			}
+			break;
+		}
+		stats.bytesReceived += isMeasuring ? uint64_t(nrRead) : 0;
+	}
+
+	bool isComplete{};
+	MessageType type{};
+	MessageReader payload{};
+	size_t size{};
+	if (!PeekMessage(input.data(), input.size(), isComplete, type, payload, size))
+	{
+		return false;
+	}
+	if (!isComplete)
+	{
+		return true;
+	}
+	// Only one tick is ever in flight, so this is the answer to it and nothing comes after it
+	uint32_t tick{};
+	if (type != MessageType::Deltas || !Take(payload, tick) || tick != client.tick || size != input.size())
+	{
+		return false;
+	}
+	Clock::time_point answeredAt{ Clock::now() };
+	float latency{ std::chrono::duration<float, std::milli>(answeredAt - client.sentAt).count() };
+	while (!IsDone(payload))
+	{
+		if (!TakeDelta(payload, client.seen))
+		{
+			return false;
+		}
+	}
+	input.clear();
+	isAnswered = true;
+
+	if (isVerifying)
+	{
+		for (size_t i = 0; i < client.games.size(); i++)
+		{
+			Step(client.games[i], client.inputs[i]);
+			GameSnapshot expected;
+			TakeSnapshot(expected, client.games[i]);
+			stats.nrMismatches += IsSameSnapshot(expected, client.seen[i]) ? 0 : 1;
+		}
+	}
+	if (isMeasuring)
+	{
+		stats.firstAnswer = stats.nrTicks == 0 ? answeredAt : stats.firstAnswer;
+		stats.lastAnswer = answeredAt;
+		stats.nrTicks++;
+		stats.nrGameTicks += client.seen.size();
+		stats.latencies.push_back(latency);
+	}
+	return true;
+}
+
+bool Flush(int epollFd, Client& client)
+{
+	// A tick is small, the socket only fills up while the first one starts every game. Then the rest waits for the
+	// socket to take more instead of spinning, the server may be running on the same cores.
+	std::vector<uint8_t>& output{ client.output };
+	while (client.outputSent < output.size())
+	{
+		ssize_t nrSent{ send(client.fd, &output[client.outputSent], output.size() - client.outputSent, MSG_NOSIGNAL) };
+		if (nrSent < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				return false;
+			}
+			break;
+		}
+		client.outputSent += size_t(nrSent);
+	}
+	bool isDrained{ client.outputSent == output.size() };
+	if (isDrained)
+	{
+		output.clear();
+		client.outputSent = 0;
+	}
+	if (isDrained == client.isWaitingToWrite)
+	{
+		client.isWaitingToWrite = !isDrained;
+		epoll_event event{};
+		event.events = EPOLLIN | EPOLLRDHUP | (isDrained ? 0 : EPOLLOUT);
+		event.data.ptr = &client;
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event);
+	}
+	return true;
+}
+
+float Percentile(std::vector<float>& values, float fraction)
+{
+	size_t index{ std::min(values.size() - 1, size_t(fraction * values.size())) };
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
@@ -0,0 +1,508 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "MatchProtocol.h"
+#include "Socket.h"
+
+// Runs headless games for clients over TCP or a Unix socket. Every core runs its own epoll loop, all loops wait on
+// the one listening socket and the kernel wakes only one of them per connection, which that loop then owns with all
+// of its games. A tick message steps every game of its connection and is answered with the deltas of that step,
+// so the clients drive the clock and a loop never waits for anything but its sockets.
+struct ServerSettings
+{
+	Address address;
+	int nrLoops;
+	int statsSeconds;
+};
+
+struct ServerGame
+{
+	GameState state;
+	GameSnapshot sent;
+	bool isLive;
+};
+
+struct Connection
+{
+	int fd;
+	size_t index; // in its loop's connections
+	std::vector<uint8_t> input; // bytes received, the last message may not be complete yet
+	std::vector<uint8_t> output;
+	size_t outputSent;
+	uint32_t events; // what epoll waits for
+	bool isEnded; // the client stopped sending, the connection closes once its answers are sent
+	std::vector<ServerGame> games;
+	std::vector<uint8_t> inputs; // of the tick being stepped, per game
+};
+
+// Every loop only writes its own counters, the main thread reads them for the stats
+struct alignas(64) LoopStats
+{
+	std::atomic<uint64_t> nrTicks;
+	std::atomic<uint64_t> nrSteps;
+	std::atomic<uint64_t> bytesSent;
+	std::atomic<int> nrConnections;
+};
+
+// The connections a loop owns, and its epoll instance
+struct Loop
+{
+	int epollFd;
+	std::vector<Connection*> connections;
+	LoopStats* pStats;
+};
+
+const int g_MaxEvents{ 256 };
+const size_t g_ReadSize{ 64 * 1024 };
+// The socket is level triggered, what isn't read in a wakeup wakes the loop again after the other connections had theirs
+const int g_ReadsPerWakeup{ 4 };
+// One message of the largest size still coming in, and a wakeup's reads of messages held back on top of it
+const size_t g_MaxInput{ g_MessageHeaderSize + g_MaxPayload + g_ReadsPerWakeup * g_ReadSize };
+// Above this much unsent output a connection's messages wait and its socket isn't read until the client catches up
+const size_t g_OutputHighWater{ 4 * 1024 * 1024 };
+// A client that doesn't read its deltas anymore is dropped before its backlog takes all memory
+const size_t g_MaxBacklog{ 64 * 1024 * 1024 };
+
+std::atomic<bool> g_IsRunning{ true };
+
+void PrintUsage();
+bool ParseArguments(int argc, char* args[], ServerSettings& settings);
+void RunLoop(int listenFd, LoopStats& stats);
+void Accept(Loop& loop, int listenFd);
+bool Receive(Connection& connection);
+bool Serve(Loop& loop, Connection& connection, LoopStats& stats);
+bool HandleInput(Connection& connection, LoopStats& stats, bool& isHeldBack);
+bool HandleMessage(Connection& connection, MessageType type, MessageReader& payload, LoopStats& stats);
+bool StartGames(Connection& connection, MessageReader& payload);
+bool StepGames(Connection& connection, MessageReader& payload, LoopStats& stats);
+bool Send(Loop& loop, Connection& connection);
+void WatchEvents(Loop& loop, Connection& connection);
+void Close(Loop& loop, Connection* pConnection);
+
+void Stop(int)
+{
+	g_IsRunning = false;
+}
+
+int main(int argc, char* args[])
+{
+	ServerSettings settings{ Address{ false, "127.0.0.1", g_DefaultPort }, int(std::thread::hardware_concurrency()), 5 };
+	if (!ParseArguments(argc, args, settings))
+	{
+		PrintUsage();
+		return 1;
+	}
+	if (settings.nrLoops < 1)
+	{
+		settings.nrLoops = 1;
+	}
+	int listenFd{ Listen(settings.address) };
+	if (listenFd < 0)
+	{
+		return 1;
+	}
+	signal(SIGINT, Stop);
+	signal(SIGTERM, Stop);
+	signal(SIGPIPE, SIG_IGN);
+	printf("listening on %s with %d loops\n", settings.address.isUnix ? settings.address.host.c_str() : (settings.address.host + ":" + std::to_string(settings.address.port)).c_str(), settings.nrLoops);
+	fflush(stdout);
+
+	std::vector<LoopStats> stats(settings.nrLoops);
+	std::vector<std::thread> loops;
+	for (int i = 0; i < settings.nrLoops; i++)
+	{
+		loops.emplace_back(RunLoop, listenFd, std::ref(stats[i]));
+	}
+
+	// Prints what all loops did since the last time, whenever anything happened
+	std::chrono::steady_clock::time_point t1{ std::chrono::steady_clock::now() };
+	uint64_t lastTicks{}, lastSteps{}, lastBytes{};
+	uint64_t nrTicks{}, nrSteps{}, bytesSent{};
+	while (g_IsRunning)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - t1).count() };
+		if (g_IsRunning && seconds < settings.statsSeconds)
+		{
+			continue;
+		}
+		nrTicks = nrSteps = bytesSent = 0;
+		int nrConnections{};
+		for (const LoopStats& loop : stats)
+		{
+			nrTicks += loop.nrTicks.load(std::memory_order_relaxed);
+			nrSteps += loop.nrSteps.load(std::memory_order_relaxed);
+			bytesSent += loop.bytesSent.load(std::memory_order_relaxed);
+			nrConnections += loop.nrConnections.load(std::memory_order_relaxed);
+		}
+		if (nrTicks > lastTicks)
+		{
+			printf("%d connections, %.0f ticks/s, %.0f game steps/s, %.1f MB/s out\n", nrConnections, (nrTicks - lastTicks) / seconds,
+				(nrSteps - lastSteps) / seconds, (bytesSent - lastBytes) / seconds / 1e6);
+			fflush(stdout);
+		}
+		lastTicks = nrTicks;
+		lastSteps = nrSteps;
+		lastBytes = bytesSent;
+		t1 = std::chrono::steady_clock::now();
+	}
+
+	for (std::thread& loop : loops)
+	{
+		loop.join();
+	}
+	close(listenFd);
+	if (settings.address.isUnix)
+	{
+		unlink(settings.address.host.c_str());
+	}
+	printf("stopped after %llu ticks, %llu game steps\n", (unsigned long long)nrTicks, (unsigned long long)nrSteps);
+	return 0;
+}
+
+void PrintUsage()
+{
+	printf("usage: tetris_server [--listen host:port|unix:path] [--loops n] [--stats seconds]\n");
+}
+
+bool ParseArguments(int argc, char* args[], ServerSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--listen") == 0 && i + 1 < argc)
+		{
+			if (!ParseAddress(args[++i], settings.address))
+			{
+				return false;
+			}
+		}
+		else if (strcmp(args[i], "--loops") == 0 && i + 1 < argc)
+		{
+			settings.nrLoops = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "--stats") == 0 && i + 1 < argc)
+		{
+			settings.statsSeconds = atoi(args[++i]);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void RunLoop(int listenFd, LoopStats& stats)
+{
+	Loop loop{ epoll_create1(0), {}, &stats };
+	// The listening socket is the one event without a connection
+	epoll_event listenEvent{};
+	listenEvent.events = EPOLLIN | EPOLLEXCLUSIVE;
+	listenEvent.data.ptr = nullptr;
+	epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent);
+
+	epoll_event events[g_MaxEvents];
+	while (g_IsRunning)
+	{
+		// Wakes up now and then to see whether the server is stopping
+		int nrEvents{ epoll_wait(loop.epollFd, events, g_MaxEvents, 200) };
+		for (int i = 0; i < nrEvents; i++)
+		{
+			Connection* pConnection{ static_cast<Connection*>(events[i].data.ptr) };
+			if (!pConnection)
+			{
+				Accept(loop, listenFd);
+				continue;
+			}
+			// A hang up is read as the end of the stream, unless the connection isn't being read right now
+			bool isOpen{ !(events[i].events & EPOLLERR) };
+			if (isOpen && (pConnection->events & EPOLLIN) && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)))
+			{
+				isOpen = Receive(*pConnection);
+			}
+			if (isOpen)
+			{
+				isOpen = Serve(loop, *pConnection, stats);
+			}
+			if (!isOpen)
+			{
+				Close(loop, pConnection);
+			}
+		}
+	}
+
+	while (!loop.connections.empty())
+	{
+		Close(loop, loop.connections.back());
+	}
+	close(loop.epollFd);
+}
+
+void Accept(Loop& loop, int listenFd)
+{
+	while (true)
+	{
+		int fd{ accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK) };
+		if (fd < 0)
+		{
+			// Another loop took it, or there is nothing left to take
+			return;
+		}
+		int on{ 1 };
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		Connection* pConnection{ new Connection{ fd, loop.connections.size(), {}, {}, 0, EPOLLIN | EPOLLRDHUP, false, {}, {} } };
+		epoll_event event{};
+		event.events = pConnection->events;
+		event.data.ptr = pConnection;
+		if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			close(fd);
+			delete pConnection;
+			continue;
+		}
+		loop.connections.push_back(pConnection);
+		loop.pStats->nrConnections.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+bool Receive(Connection& connection)
+{
+	std::vector<uint8_t>& input{ connection.input };
+	for (int i = 0; i < g_ReadsPerWakeup; i++)
+	{
+		if (input.size() > g_MaxInput)
+		{
+			return false;
+		}
+		size_t size{ input.size() };
+		input.resize(size + g_ReadSize);
+		ssize_t nrRead{ recv(connection.fd, &input[size], g_ReadSize, 0) };
+		input.resize(size + (nrRead > 0 ? size_t(nrRead) : 0));
+		if (nrRead == 0)
+		{
+			// What came before the end is still answered
+			connection.isEnded = true;
+			break;
+		}
+		if (nrRead < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				return false;
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+bool Serve(Loop& loop, Connection& connection, LoopStats& stats)
+{
+	// Answers messages and sends, as long as the socket takes the answers as fast as they are made
+	bool isHeldBack{};
+	do
+	{
+		if (!HandleInput(connection, stats, isHeldBack) || !Send(loop, connection))
+		{
+			return false;
+		}
+	} while (isHeldBack && connection.output.size() - connection.outputSent <= g_OutputHighWater);
+
+	size_t backlog{ connection.output.size() - connection.outputSent };
+	if (backlog > g_MaxBacklog || (connection.isEnded && backlog == 0))
+	{
+		return false;
+	}
+	WatchEvents(loop, connection);
+	return true;
+}
+
+bool HandleInput(Connection& connection, LoopStats& stats, bool& isHeldBack)
+{
+	// Every whole message that came in, until the output is over the high water mark
+	std::vector<uint8_t>& input{ connection.input };
+	size_t offset{};
+	isHeldBack = false;
+	while (true)
+	{
+		if (connection.output.size() - connection.outputSent > g_OutputHighWater)
+		{
+			isHeldBack = true;
+			break;
+		}
+		bool isComplete{};
+		MessageType type{};
+		MessageReader payload{};
+		size_t size{};
+		if (!PeekMessage(input.data() + offset, input.size() - offset, isComplete, type, payload, size))
+		{
+			return false;
+		}
+		if (!isComplete)
+		{
+			break;
+		}
+		if (!HandleMessage(connection, type, payload, stats))
+		{
+			return false;
+		}
+		offset += size;
+	}
+	input.erase(input.begin(), input.begin() + offset);
+	return input.size() <= g_MaxInput;
+}
+
+bool HandleMessage(Connection& connection, MessageType type, MessageReader& payload, LoopStats& stats)
+{
+	switch (type)
+	{
+	case MessageType::NewGames:
+		return StartGames(connection, payload);
+	case MessageType::Tick:
+		return StepGames(connection, payload, stats);
+	default:
+		// Deltas only go to clients
+		return false;
+	}
+}
+
+bool StartGames(Connection& connection, MessageReader& payload)
+{
+	while (!IsDone(payload))
+	{
+		uint16_t game{};
+		uint64_t seed{};
+		if (!Take(payload, game) || !Take(payload, seed))
+		{
+			return false;
+		}
+		if (game >= connection.games.size())
+		{
+			connection.games.resize(game + 1);
+			connection.inputs.resize(game + 1);
+		}
+		// The client starts from an empty snapshot as well, so the first delta carries the whole game
+		ServerGame& serverGame{ connection.games[game] };
+		NewGame(serverGame.state, seed);
+		serverGame.sent = GameSnapshot{};
+		serverGame.isLive = true;
+	}
+	return true;
+}
+
+bool StepGames(Connection& connection, MessageReader& payload, LoopStats& stats)
+{
+	uint32_t tick{};
+	if (!Take(payload, tick))
+	{
+		return false;
+	}
+	while (!IsDone(payload))
+	{
+		uint16_t game{};
+		uint8_t input{};
+		if (!Take(payload, game) || !Take(payload, input) || game >= connection.inputs.size())
+		{
+			return false;
+		}
+		connection.inputs[game] |= input;
+	}
+
+	std::vector<uint8_t>& output{ connection.output };
+	size_t start{ StartMessage(output, MessageType::Deltas) };
+	Put(output, tick);
+	uint64_t nrSteps{};
+	for (size_t i = 0; i < connection.games.size(); i++)
+	{
+		ServerGame& game{ connection.games[i] };
+		uint8_t input{ connection.inputs[i] };
+		connection.inputs[i] = InputNone;
+		if (!game.isLive)
+		{
+			continue;
+		}
+		Step(game.state, input);
+		PutDelta(output, uint16_t(i), game.state, game.sent);
+		nrSteps++;
+		// A game that is over is sent once more and then waits for the client to start it again
+		game.isLive = !game.state.isGameOver;
+	}
+	EndMessage(output, start);
+	stats.nrTicks.fetch_add(1, std::memory_order_relaxed);
+	stats.nrSteps.fetch_add(nrSteps, std::memory_order_relaxed);
+	return true;
+}
+
+bool Send(Loop& loop, Connection& connection)
+{
+	std::vector<uint8_t>& output{ connection.output };
+	while (connection.outputSent < output.size())
+	{
+		ssize_t nrSent{ send(connection.fd, &output[connection.outputSent], output.size() - connection.outputSent, MSG_NOSIGNAL) };
+		if (nrSent < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				return false;
+			}
+			break;
+		}
+		connection.outputSent += size_t(nrSent);
+		loop.pStats->bytesSent.fetch_add(uint64_t(nrSent), std::memory_order_relaxed);
+	}
+	if (connection.outputSent == output.size())
+	{
+		output.clear();
+		connection.outputSent = 0;
+	}
+	return true;
+}
+
+void WatchEvents(Loop& loop, Connection& connection)
+{
+	// Reads while the client is sending and isn't behind, waits for the socket to take more while anything is unsent
+	size_t backlog{ connection.output.size() - connection.outputSent };
+	bool isReading{ !connection.isEnded && backlog <= g_OutputHighWater };
+	uint32_t events{ (isReading ? uint32_t(EPOLLIN | EPOLLRDHUP) : 0u) | (backlog > 0 ? uint32_t(EPOLLOUT) : 0u) };
+	if (events != connection.events)
+	{
+		connection.events = events;
+		epoll_event event{};
+		event.events = events;
+		event.data.ptr = &connection;
+		epoll_ctl(loop.epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+	}
+}
+
+void Close(Loop& loop, Connection* pConnection)
+{
+	// The last connection takes the place of the closed one
+	Connection* pLast{ loop.connections.back() };
+	pLast->index = pConnection->index;
+	loop.connections[pLast->index] = pLast;
+	loop.connections.pop_back();
+	epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, pConnection->fd, nullptr);
+	close(pConnection->fd);
+	delete pConnection;
+	loop.pStats->nrConnections.fetch_sub(1, std::memory_order_relaxed);
+}
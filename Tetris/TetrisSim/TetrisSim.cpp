@@ -0,0 +1,409 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Policy.h"
+#include "Corpus.h"
+#include "Versus.h"
+
+// Plays a range of seeded games headless on every core and prints score and line statistics,
+// plays versus matches between two computer players, or plays back one recorded game and checks that it ends the same way.
+struct SimSettings
+{
+	uint64_t firstSeed;
+	uint32_t nrGames;
+	PolicyType policy;
+	int nrThreads;
+	int maxPieces;
+	float gravity;
+	int tableMegabytes;
+	const char* pRecordDir; // every game is saved there as <seed>.replay
+	const char* pCorpusPath; // or all games in one corpus
+	const char* pReplayPath;
+	bool isVersus; // every seed is a match instead of a game
+	uint32_t maxSteps; // of a match, a draw when neither lost by then
+};
+
+// Seeds a worker still has to play, packed in one word so it can be split with a single compare and swap:
+// the low 32 bits are the first and the high 32 bits the end, both as offsets from the first seed.
+// The owner takes games from the front, an idle worker steals the back half.
+struct alignas(64) WorkQueue
+{
+	std::atomic<uint64_t> range;
+};
+
+// Every worker only writes its own stats, they are added up after all workers are done
+struct alignas(64) WorkerStats
+{
+	uint64_t nrGames;
+	uint64_t nrPieces;
+	uint64_t nrLines;
+	uint64_t score;
+	int maxLines;
+	int nrSteals;
+	int nrFallbacks;
+	TableStats table;
+};
+
+// The workers add their games one at a time, in the order they finish
+CorpusWriter g_Corpus{};
+std::mutex g_CorpusMutex{};
+
+void PrintUsage();
+int PlayBack(const char* pPath);
+int PlayMatches(const SimSettings& settings);
+bool ParseArguments(int argc, char* args[], SimSettings& settings);
+void RunWorker(int id, const SimSettings& settings, std::vector<WorkQueue>& queues, WorkerStats& stats);
+bool TakeSeed(WorkQueue& queue, uint32_t& offset);
+bool StealSeeds(std::vector<WorkQueue>& queues, int thief);
+
+inline uint64_t PackRange(uint32_t first, uint32_t end)
+{
+	return uint64_t(end) << 32 | first;
+}
+
+int main(int argc, char* args[])
+{
+	SimSettings settings{ 0, 10000, PolicyType::Greedy, int(std::thread::hardware_concurrency()), 500, g_DefaultGravity, g_DefaultSearch.tableMegabytes, nullptr, nullptr, nullptr,
+		false, 5 * 60 * g_StepsPerSecond };
+	if (!ParseArguments(argc, args, settings))
+	{
+		PrintUsage();
+		return 1;
+	}
+	if (settings.pReplayPath)
+	{
+		return PlayBack(settings.pReplayPath);
+	}
+	if (settings.nrThreads < 1)
+	{
+		settings.nrThreads = 1;
+	}
+	if (settings.isVersus)
+	{
+		return PlayMatches(settings);
+	}
+	if (settings.pCorpusPath && !OpenCorpusWriter(g_Corpus, settings.pCorpusPath))
+	{
+		printf("could not write corpus %s\n", settings.pCorpusPath);
+		return 1;
+	}
+
+	// Every worker starts with an equal share, stealing evens out games that take longer
+	std::vector<WorkQueue> queues(settings.nrThreads);
+	std::vector<WorkerStats> stats(settings.nrThreads);
+	for (int i = 0; i < settings.nrThreads; i++)
+	{
+		uint32_t first{ uint32_t(uint64_t(settings.nrGames) * i / settings.nrThreads) };
+		uint32_t end{ uint32_t(uint64_t(settings.nrGames) * (i + 1) / settings.nrThreads) };
+		queues[i].range.store(PackRange(first, end));
+		stats[i] = WorkerStats{};
+	}
+
+	std::chrono::steady_clock::time_point t1{ std::chrono::steady_clock::now() };
+	std::vector<std::thread> workers;
+	for (int i = 1; i < settings.nrThreads; i++)
+	{
+		workers.emplace_back(RunWorker, i, std::cref(settings), std::ref(queues), std::ref(stats[i]));
+	}
+	RunWorker(0, settings, queues, stats[0]);
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - t1).count() };
+	if (settings.pCorpusPath && !CloseCorpusWriter(g_Corpus))
+	{
+		printf("could not write corpus %s\n", settings.pCorpusPath);
+	}
+
+	WorkerStats total{};
+	for (const WorkerStats& worker : stats)
+	{
+		total.nrGames += worker.nrGames;
+		total.nrPieces += worker.nrPieces;
+		total.nrLines += worker.nrLines;
+		total.score += worker.score;
+		total.maxLines = worker.maxLines > total.maxLines ? worker.maxLines : total.maxLines;
+		total.nrSteals += worker.nrSteals;
+		total.nrFallbacks += worker.nrFallbacks;
+		AddTableStats(total.table, worker.table);
+	}
+
+	double nrGames{ total.nrGames > 0 ? double(total.nrGames) : 1.0 };
+	printf("games       %llu on %d threads in %.3f s\n", (unsigned long long)total.nrGames, settings.nrThreads, seconds);
+	printf("games/s     %.1f\n", total.nrGames / seconds);
+	printf("pieces/s    %.0f\n", total.nrPieces / seconds);
+	printf("mean score  %.1f\n", total.score / nrGames);
+	printf("mean lines  %.2f (max %d)\n", total.nrLines / nrGames, total.maxLines);
+	printf("mean pieces %.1f\n", total.nrPieces / nrGames);
+	printf("steals      %d\n", total.nrSteals);
+	if (total.nrFallbacks > 0)
+	{
+		printf("fallbacks   %d pieces couldn't be placed and were left to gravity\n", total.nrFallbacks);
+	}
+	if (total.table.probes > 0)
+	{
+		double nrProbes{ double(total.table.probes) };
+		printf("table       %.1f%% hits, %.2f%% collisions of %llu probes\n", 100.0 * total.table.hits / nrProbes,
+			100.0 * total.table.collisions / nrProbes, (unsigned long long)total.table.probes);
+	}
+	return 0;
+}
+
+void PrintUsage()
+{
+	printf("usage: tetris_sim [--seeds first count] [--policy random|greedy|beam] [--threads n] [--max-pieces n] [--gravity cells/s] [--table-mb n] [--record dir] [--corpus file]\n");
+	printf("       tetris_sim --versus [--seeds first count] [--policy random|greedy|beam] [--threads n] [--max-steps n] [--gravity cells/s]\n");
+	printf("       tetris_sim --replay file\n");
+}
+
+int PlayBack(const char* pPath)
+{
+	Replay replay{};
+	if (!LoadReplay(replay, pPath))
+	{
+		printf("could not read replay %s\n", pPath);
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point t1{ std::chrono::steady_clock::now() };
+	ReplayPlayer player{};
+	StartPlayback(player, ViewReplay(replay));
+	PlayReplay(player, replay.header.endStep);
+	float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - t1).count() };
+
+	const GameState& state{ player.position.state };
+	bool isMatch{ MatchesRecording(replay.header, state) };
+	printf("seed        %llu\n", (unsigned long long)replay.header.seed);
+	printf("steps       %d in %.3f ms, %.0f steps/s\n", state.counter, seconds * 1000.f, state.counter / seconds);
+	printf("events      %u in %u bytes, %.2f bytes per piece\n", replay.header.nrEvents, replay.header.nrBytes,
+		state.blocksUsed > 0 ? double(replay.header.nrBytes) / state.blocksUsed : 0.0);
+	printf("keyframes   %d\n", int(player.keyframes.size()));
+	printf("result      %d pieces, %d lines, score %d%s\n", state.blocksUsed, state.lines, state.score, state.isGameOver ? ", game over" : "");
+	printf("recording   %s%s\n", isMatch ? "matches" : "DOES NOT MATCH", player.position.isBroken ? ", stopped at an invalid event" : "");
+	return isMatch ? 0 : 2;
+}
+
+int PlayMatches(const SimSettings& settings)
+{
+	VersusSettings versus{ settings.firstSeed, settings.nrGames, settings.policy, settings.nrThreads, settings.maxSteps, settings.gravity };
+	std::vector<VersusResult> results;
+	std::chrono::steady_clock::time_point t1{ std::chrono::steady_clock::now() };
+	PlayVersus(versus, results);
+	float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - t1).count() };
+
+	uint64_t nrSteps{}, nrLines{}, nrPieces{};
+	int wins[2]{}, nrDraws{}, nrFallbacks{};
+	for (const VersusResult& result : results)
+	{
+		nrSteps += result.nrSteps;
+		nrLines += result.linesSent[0] + result.linesSent[1];
+		nrPieces += result.nrPieces[0] + result.nrPieces[1];
+		nrFallbacks += result.nrFallbacks[0] + result.nrFallbacks[1];
+		if (result.winner < 0)
+		{
+			nrDraws++;
+		}
+		else
+		{
+			wins[result.winner]++;
+		}
+	}
+
+	double nrMatches{ results.empty() ? 1.0 : double(results.size()) };
+	printf("matches     %u on %d threads in %.3f s\n", settings.nrGames, settings.nrThreads, seconds);
+	printf("matches/s   %.1f\n", results.size() / seconds);
+	printf("steps/s     %.0f\n", 2.0 * nrSteps / seconds);
+	printf("wins        %d - %d, %d draws\n", wins[0], wins[1], nrDraws);
+	printf("mean length %.1f s\n", nrSteps / nrMatches / g_StepsPerSecond);
+	printf("mean sent   %.2f lines\n", nrLines / nrMatches);
+	printf("mean pieces %.1f\n", nrPieces / nrMatches);
+	if (nrFallbacks > 0)
+	{
+		printf("fallbacks   %d pieces couldn't be placed and were left to gravity\n", nrFallbacks);
+	}
+	return 0;
+}
+
+bool ParseArguments(int argc, char* args[], SimSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--seeds") == 0 && i + 2 < argc)
+		{
+			settings.firstSeed = strtoull(args[++i], nullptr, 10);
+			settings.nrGames = uint32_t(strtoul(args[++i], nullptr, 10));
+			if (settings.nrGames < 1)
+			{
+				return false;
+			}
+		}
+		else if (strcmp(args[i], "--policy") == 0 && i + 1 < argc)
+		{
+			if (!ParsePolicyType(args[++i], settings.policy))
+			{
+				return false;
+			}
+		}
+		else if (strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+		{
+			settings.nrThreads = atoi(args[++i]);
+			if (settings.nrThreads < 1)
+			{
+				return false;
+			}
+		}
+		else if (strcmp(args[i], "--max-pieces") == 0 && i + 1 < argc)
+		{
+			settings.maxPieces = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "--versus") == 0)
+		{
+			settings.isVersus = true;
+		}
+		else if (strcmp(args[i], "--max-steps") == 0 && i + 1 < argc)
+		{
+			settings.maxSteps = uint32_t(strtoul(args[++i], nullptr, 10));
+		}
+		else if (strcmp(args[i], "--gravity") == 0 && i + 1 < argc)
+		{
+			// Written so that not a number fails too
+			settings.gravity = float(atof(args[++i]));
+			if (!(settings.gravity > 0.f))
+			{
+				return false;
+			}
+		}
+		else if (strcmp(args[i], "--table-mb") == 0 && i + 1 < argc)
+		{
+			settings.tableMegabytes = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "--record") == 0 && i + 1 < argc)
+		{
+			settings.pRecordDir = args[++i];
+		}
+		else if (strcmp(args[i], "--corpus") == 0 && i + 1 < argc)
+		{
+			settings.pCorpusPath = args[++i];
+		}
+		else if (strcmp(args[i], "--replay") == 0 && i + 1 < argc)
+		{
+			settings.pReplayPath = args[++i];
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void RunWorker(int id, const SimSettings& settings, std::vector<WorkQueue>& queues, WorkerStats& stats)
+{
+	GameState state{};
+	BeamSearch search{};
+	Policy policy{};
+	policy.pSearch = &search;
+	Replay replay{};
+	if (settings.policy == PolicyType::Beam)
+	{
+		// Every worker has its own cache, kept over all its games
+		SearchSettings searchSettings{ g_DefaultSearch };
+		searchSettings.tableMegabytes = settings.tableMegabytes;
+		InitBeamSearch(search, searchSettings);
+	}
+	while (true)
+	{
+		uint32_t offset{};
+		if (!TakeSeed(queues[id], offset))
+		{
+			if (!StealSeeds(queues, id))
+			{
+				stats.table = search.tableStats;
+				stats.nrFallbacks = policy.nrFallbacks;
+				return;
+			}
+			stats.nrSteals++;
+			continue;
+		}
+
+		uint64_t seed{ settings.firstSeed + offset };
+		NewGame(state, seed, settings.gravity);
+		ResetPolicy(policy, settings.policy, seed);
+		bool isRecording{ settings.pRecordDir || settings.pCorpusPath };
+		PlayGame(state, policy, settings.maxPieces, isRecording ? &replay : nullptr);
+		if (settings.pRecordDir)
+		{
+			std::string path{ std::string{ settings.pRecordDir } + "/" + std::to_string(seed) + ".replay" };
+			if (!SaveReplay(replay, path.c_str()))
+			{
+				printf("could not write replay %s\n", path.c_str());
+			}
+		}
+		if (settings.pCorpusPath)
+		{
+			std::lock_guard<std::mutex> lock{ g_CorpusMutex };
+			AddToCorpus(g_Corpus, replay);
+		}
+
+		stats.nrGames++;
+		stats.nrPieces += state.blocksUsed;
+		stats.nrLines += state.lines;
+		stats.score += state.score;
+		stats.maxLines = state.lines > stats.maxLines ? state.lines : stats.maxLines;
+	}
+}
+
+bool TakeSeed(WorkQueue& queue, uint32_t& offset)
+{
+	uint64_t range{ queue.range.load(std::memory_order_relaxed) };
+	while (true)
+	{
+		uint32_t first{ uint32_t(range) };
+		uint32_t end{ uint32_t(range >> 32) };
+		if (first >= end)
+		{
+			return false;
+		}
+		// Only fails when a thief split the range at the same moment
+		if (queue.range.compare_exchange_weak(range, PackRange(first + 1, end), std::memory_order_acq_rel))
+		{
+			offset = first;
+			return true;
+		}
+	}
+}
+
+bool StealSeeds(std::vector<WorkQueue>& queues, int thief)
+{
+	// The thief's own queue is empty, so nobody else touches it until the stolen half is stored in it
+	int nrQueues{ int(queues.size()) };
+	for (int i = 1; i < nrQueues; i++)
+	{
+		WorkQueue& victim{ queues[(thief + i) % nrQueues] };
+		uint64_t range{ victim.range.load(std::memory_order_relaxed) };
+		while (true)
+		{
+			uint32_t first{ uint32_t(range) };
+			uint32_t end{ uint32_t(range >> 32) };
+			if (first >= end)
+			{
+				break;
+			}
+			uint32_t middle{ first + (end - first) / 2 };
+			if (victim.range.compare_exchange_weak(range, PackRange(first, middle), std::memory_order_acq_rel))
+			{
+				queues[thief].range.store(PackRange(middle, end), std::memory_order_release);
+				return true;
+			}
+		}
+	}
+	return false;
+}